@@ -0,0 +1,45 @@
+// Common code for benchmarks
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "abstract_file.h"
+
+void bench_check( blargg_err_t err )
+{
+	if ( err )
+	{
+		fprintf( stderr, "Error: %s\n", err );
+		exit( EXIT_FAILURE );
+	}
+}
+
+void bench_load( Nes_Emu& emu, const char* path )
+{
+	static char* pixels;
+	if ( !pixels )
+	{
+		long size = Nes_Emu::buffer_width * (Nes_Emu::image_height + 16);
+		pixels = (char*) calloc( size, 1 );
+		if ( !pixels )
+			bench_check( "Out of memory" );
+	}
+	emu.set_pixels( pixels + Nes_Emu::buffer_width * 8, Nes_Emu::buffer_width );
+	
+	Std_File_Reader in;
+	bench_check( in.open( path ) );
+	bench_check( emu.load_ines( in ) );
+}
+
+double bench_now()
+{
+	return Nes_Latency::now() * 1e-6;
+}
+
+Data_Writer::error_t Stdout_Writer::write( const void* p, long n )
+{
+	if ( (long) fwrite( p, 1, n, stdout ) != n )
+		return "Couldn't write to stdout";
+	return 0;
+}
@@ -0,0 +1,26 @@
+
+// Common code for benchmarks
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "Nes_Emu.h"
+#include "Nes_Latency.h"
+
+// Allocate graphics buffer for emulator and load iNES ROM into it. Exits with
+// message on error.
+void bench_load( Nes_Emu&, const char* path );
+
+// Exit with message if error is non-NULL
+void bench_check( blargg_err_t );
+
+// Time in seconds, from a steady clock
+double bench_now();
+
+// Data_Writer that writes to stdout
+class Stdout_Writer : public Data_Writer {
+public:
+	error_t write( const void*, long );
+};
+
+#endif
@@ -0,0 +1,160 @@
+// Times reading samples from Blip_Buffer and Stereo_Buffer against the original
+// one-sample-at-a-time loops, and checks that both generate identical output.
+// usage: blip_bench [frame_count]
+
+#include "bench.h"
+#include "Multi_Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef Blip_Synth<blip_good_quality,20> synth_t;
+
+long const clock_rate = 1789773;
+blip_time_t const frame_clocks = clock_rate / 60;
+int const max_frame_samples = 4096;
+
+// Adds a frame of random steps to buf. Same seed gives the same steps.
+static void add_steps( Blip_Buffer* buf, synth_t& synth, unsigned seed )
+{
+	srand( seed );
+	int amp = 0;
+	for ( blip_time_t t = 0; t < frame_clocks; t += rand() % 40 + 1 )
+	{
+		int new_amp = rand() % 41 - 20;
+		synth.offset( t, new_amp - amp, buf );
+		amp = new_amp;
+	}
+}
+
+// Blip_Buffer::read_samples() before samples were read in blocks
+static void read_mono_ref( Blip_Buffer& buf, blip_sample_t* out, long count )
+{
+	Blip_Reader in;
+	int bass = in.begin( buf );
+	while ( count-- )
+	{
+		long s = in.read();
+		in.next( bass );
+		*out++ = (blip_sample_t) s;
+		if ( (blip_sample_t) s != s )
+			out [-1] = (blip_sample_t) (0x7FFF - (s >> 24));
+	}
+	in.end( buf );
+}
+
+// Stereo_Buffer::mix_stereo() before samples were read in blocks
+static void mix_stereo_ref( Multi_Buffer::channel_t const& ch, blip_sample_t* out, long count )
+{
+	Blip_Reader left;
+	Blip_Reader right;
+	Blip_Reader center;
+	left.begin( *ch.left );
+	right.begin( *ch.right );
+	int bass = center.begin( *ch.center );
+	while ( count-- )
+	{
+		int c = center.read();
+		long l = c + left.read();
+		long r = c + right.read();
+		center.next( bass );
+		left.next( bass );
+		right.next( bass );
+		out [0] = (blip_sample_t) l;
+		out [1] = (blip_sample_t) r;
+		if ( (blip_sample_t) l != l )
+			out [0] = (blip_sample_t) (0x7FFF - (l >> 24));
+		if ( (blip_sample_t) r != r )
+			out [1] = (blip_sample_t) (0x7FFF - (r >> 24));
+		out += 2;
+	}
+	center.end( *ch.center );
+	right.end( *ch.right );
+	left.end( *ch.left );
+}
+
+int main( int argc, char** argv )
+{
+	int frame_count = (argc > 1 ? atoi( argv [1] ) : 3000);
+	
+	static blip_sample_t expected [max_frame_samples * 2];
+	static blip_sample_t out [max_frame_samples * 2];
+	
+	synth_t synth;
+	synth.volume( 1.0 );
+	
+	int differ_count = 0;
+	static long const rates [] = { 44100, 48000, 96000 };
+	printf( "us/frame    mono: original  blocks   stereo: original  blocks\n" );
+	for ( int i = 0; i < 3; i++ )
+	{
+		Blip_Buffer mono_ref, mono;
+		Stereo_Buffer stereo_ref, stereo;
+		bench_check( mono_ref.set_sample_rate( rates [i], 100 ) );
+		bench_check( mono.set_sample_rate( rates [i], 100 ) );
+		bench_check( stereo_ref.set_sample_rate( rates [i], 100 ) );
+		bench_check( stereo.set_sample_rate( rates [i], 100 ) );
+		mono_ref.clock_rate( clock_rate );
+		mono.clock_rate( clock_rate );
+		stereo_ref.clock_rate( clock_rate );
+		stereo.clock_rate( clock_rate );
+		
+		Multi_Buffer::channel_t ref_ch = stereo_ref.channel( 0 );
+		Multi_Buffer::channel_t ch = stereo.channel( 0 );
+		
+		double mono_times [2] = { 0, 0 };
+		double stereo_times [2] = { 0, 0 };
+		bool same = true;
+		for ( int f = 0; f < frame_count; f++ )
+		{
+			add_steps( &mono_ref, synth, f );
+			add_steps( &mono, synth, f );
+			mono_ref.end_frame( frame_clocks );
+			mono.end_frame( frame_clocks );
+			
+			long count = mono.samples_avail();
+			double start = bench_now();
+			read_mono_ref( mono_ref, expected, count );
+			mono_ref.remove_samples( count );
+			double mid = bench_now();
+			mono.read_samples( out, count );
+			mono_times [0] += mid - start;
+			mono_times [1] += bench_now() - mid;
+			if ( memcmp( out, expected, count * sizeof *out ) )
+				same = false;
+			
+			add_steps( ref_ch.center, synth, f * 3 + 0 );
+			add_steps( ref_ch.left,   synth, f * 3 + 1 );
+			add_steps( ref_ch.right,  synth, f * 3 + 2 );
+			add_steps( ch.center,     synth, f * 3 + 0 );
+			add_steps( ch.left,       synth, f * 3 + 1 );
+			add_steps( ch.right,      synth, f * 3 + 2 );
+			stereo_ref.end_frame( frame_clocks, true );
+			stereo.end_frame( frame_clocks, true );
+			
+			count = stereo.samples_avail();
+			start = bench_now();
+			mix_stereo_ref( ref_ch, expected, count / 2 );
+			ref_ch.center->remove_samples( count / 2 );
+			ref_ch.left->remove_samples( count / 2 );
+			ref_ch.right->remove_samples( count / 2 );
+			mid = bench_now();
+			stereo.read_samples( out, count );
+			stereo_times [0] += mid - start;
+			stereo_times [1] += bench_now() - mid;
+			if ( memcmp( out, expected, count * sizeof *out ) )
+				same = false;
+		}
+		if ( !same )
+			differ_count++;
+		
+		double const scale = 1e6 / frame_count;
+		printf( "%5ld Hz %14.2f %7.2f %17.2f %7.2f%s\n", rates [i],
+				mono_times [0] * scale, mono_times [1] * scale,
+				stereo_times [0] * scale, stereo_times [1] * scale,
+				(same ? "" : "  OUTPUT DIFFERS") );
+	}
+	
+	return (differ_count ? EXIT_FAILURE : 0);
+}
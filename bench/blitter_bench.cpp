@@ -0,0 +1,96 @@
+// Times Nes_Blitter's NTSC filter using scalar and vectorized code and several
+// threads, and checks that all of them generate identical output.
+// usage: blitter_bench rom.nes [frame_count]
+
+#include "bench.h"
+#include "Nes_Blitter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int const out_pitch = Nes_Emu::image_width * 3 * 4;
+int const out_size = out_pitch * Nes_Emu::image_height;
+
+struct config_t
+{
+	const char* name;
+	bool simd;
+	int threads;
+};
+
+static config_t const configs [] = {
+	{ "scalar",           false, 1 },
+	{ "simd",             true,  1 },
+	{ "simd, 2 threads",  true,  2 },
+	{ "simd, 4 threads",  true,  4 },
+};
+int const config_count = sizeof configs / sizeof configs [0];
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		fprintf( stderr, "usage: %s rom.nes [frame_count]\n", argv [0] );
+		return EXIT_FAILURE;
+	}
+	int frame_count = (argc > 2 ? atoi( argv [2] ) : 1000);
+	
+	static Nes_Emu emu;
+	bench_load( emu, argv [1] );
+	for ( int n = 60; n--; )
+		bench_check( emu.emulate_frame( 0 ) ); // get past blank title screen
+	
+	Nes_Blitter blitter;
+	bench_check( blitter.init() );
+	
+	char* expected = (char*) malloc( out_size );
+	char* out = (char*) malloc( out_size );
+	if ( !expected || !out )
+		bench_check( "Out of memory" );
+	
+	int differ_count = 0;
+	static int const depths [] = { 16, 32 };
+	for ( int d = 0; d < 2; d++ )
+	{
+		Nes_Blitter::setup_t s = blitter.setup();
+		s.out_depth = depths [d];
+		bench_check( blitter.setup( s ) );
+		
+		blitter.enable_simd( false );
+		bench_check( blitter.set_thread_count( 1 ) );
+		memset( expected, 0, out_size );
+		blitter.blit( emu, expected, out_pitch );
+		
+		printf( "%d-bit output, %dx%d:\n", depths [d], blitter.out_width(),
+				blitter.out_height() );
+		for ( int c = 0; c < config_count; c++ )
+		{
+			config_t const& config = configs [c];
+			blitter.enable_simd( config.simd );
+			if ( blitter.set_thread_count( config.threads ) )
+			{
+				printf( "  %-16s  (threads not compiled in)\n", config.name );
+				continue;
+			}
+			
+			memset( out, 0, out_size );
+			blitter.blit( emu, out, out_pitch );
+			bool same = !memcmp( out, expected, out_size );
+			if ( !same )
+				differ_count++;
+			
+			double start = bench_now();
+			for ( int n = frame_count; n--; )
+				blitter.blit( emu, out, out_pitch );
+			double elapsed = bench_now() - start;
+			
+			printf( "  %-16s %7.1f us/frame%s\n", config.name,
+					elapsed * 1e6 / frame_count, (same ? "" : "  OUTPUT DIFFERS") );
+		}
+	}
+	
+	free( out );
+	free( expected );
+	return (differ_count ? EXIT_FAILURE : 0);
+}
@@ -0,0 +1,94 @@
+// Records films of several lengths and periods, then times seeking, skipping and
+// reversing through them. Writes a JSON array with Nes_Recorder::write_stats()
+// for each, for tracking performance over time.
+// usage: film_bench rom.nes [seek_count]
+
+#include "bench.h"
+#include "Nes_Recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int const minutes [] = { 1, 5, 15 };
+static int const periods [] = { 60, 240, 900 };
+int const minutes_count = sizeof minutes / sizeof minutes [0];
+int const periods_count = sizeof periods / sizeof periods [0];
+
+// Same input for a given frame, varied enough to keep most games busy
+static int joypad( long frame )
+{
+	return  (frame /  7 % 5 == 0 ? 0x01 : 0) | (frame / 13 % 3 == 0 ? 0x80 : 0) |
+			(frame / 29 % 4 == 0 ? 0x08 : 0);
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		fprintf( stderr, "usage: %s rom.nes [seek_count]\n", argv [0] );
+		return EXIT_FAILURE;
+	}
+	int seek_count = (argc > 2 ? atoi( argv [2] ) : 100);
+	
+	Stdout_Writer out;
+	const char* separator = "[\n";
+	for ( int reverse = 1; reverse >= 0; reverse-- )
+	{
+		for ( int m = 0; m < minutes_count; m++ )
+		{
+			for ( int p = 0; p < periods_count; p++ )
+			{
+				Nes_Film film;
+				film.clear( periods [p] );
+				Nes_Recorder emu;
+				bench_check( emu.set_sample_rate( 44100 ) );
+				if ( !reverse )
+					emu.disable_reverse( 5 );
+				emu.set_film( &film );
+				bench_load( emu, argv [1] );
+				long const frame_count = minutes [m] * 60L * 60;
+				for ( long n = 0; n < frame_count; n++ )
+					bench_check( emu.emulate_frame( joypad( n ) ) );
+				
+				// packs the block being recorded now, rather than during the first seek
+				film.packed_size();
+				
+				srand( 7 );
+				static const char* const distances [] = { "near", "far" };
+				for ( int far = 0; far < 2; far++ )
+				{
+					emu.clear_latency();
+					for ( int n = 0; n < seek_count; n++ )
+					{
+						frame_count_t time = (far ? film.begin() + rand() % film.length() :
+								emu.tell() + rand() % 600 - 300);
+						emu.seek( film.constrain( time ) );
+						emu.next_frame();
+					}
+					
+					for ( int n = 0; n < seek_count; n++ )
+					{
+						emu.skip( rand() % 2 ? 300 : -300 );
+						emu.next_frame();
+					}
+					
+					if ( reverse )
+					{
+						emu.seek( film.begin() + 600 + rand() % (film.length() - 600) );
+						for ( int n = seek_count * 4; n--; )
+							emu.prev_frame();
+					}
+					
+					printf( "%s{\"minutes\": %d, \"reverse\": %s, \"distance\": \"%s\", \"stats\": ",
+							separator, minutes [m], (reverse ? "true" : "false"), distances [far] );
+					bench_check( emu.write_stats( out ) );
+					printf( "}" );
+					separator = ",\n";
+				}
+			}
+		}
+	}
+	printf( "\n]\n" );
+	
+	return 0;
+}
@@ -0,0 +1,164 @@
+// Times packing and unpacking recorded film blocks using each of Nes_Film_Data's
+// packing methods, and checks that blocks unpack to what was packed.
+// usage: packer_bench rom.nes [frame_count] [period]
+
+#include "bench.h"
+#include "Nes_Recorder.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef Nes_Film_Data::block_t block_t;
+int const block_size = Nes_Film_Data::block_size;
+
+// Same input for a given frame, varied enough to keep most games busy
+static int joypad( int frame )
+{
+	return  (frame /  7 % 5 == 0 ? 0x01 : 0) | (frame / 13 % 3 == 0 ? 0x80 : 0) |
+			(frame / 29 % 4 == 0 ? 0x08 : 0) | (frame / 17 % 6 == 0 ? 0x40 : 0);
+}
+
+static void copy_state( Nes_State_ const& in, Nes_State_* out )
+{
+	out->nes     = in.nes;
+	*out->cpu    = *in.cpu;
+	*out->joypad = *in.joypad;
+	*out->apu    = *in.apu;
+	*out->ppu    = *in.ppu;
+	*out->mapper = *in.mapper;
+	memcpy( out->ram,       in.ram,       in.ram_size );
+	memcpy( out->sram,      in.sram,      in.sram_max );
+	memcpy( out->spr_ram,   in.spr_ram,   in.spr_ram_size );
+	memcpy( out->nametable, in.nametable, in.nametable_max );
+	memcpy( out->chr,       in.chr,       in.chr_max );
+	out->nes_valid      = in.nes_valid;
+	out->cpu_valid      = in.cpu_valid;
+	out->joypad_valid   = in.joypad_valid;
+	out->apu_valid      = in.apu_valid;
+	out->ppu_valid      = in.ppu_valid;
+	out->mapper_valid   = in.mapper_valid;
+	out->ram_valid      = in.ram_valid;
+	out->spr_ram_valid  = in.spr_ram_valid;
+	out->sram_size      = in.sram_size;
+	out->nametable_size = in.nametable_size;
+	out->chr_size       = in.chr_size;
+}
+
+static bool same_state( Nes_State_ const& x, Nes_State_ const& y )
+{
+	return  x.timestamp() == y.timestamp() &&
+			!memcmp( x.cpu,       y.cpu,       sizeof *x.cpu ) &&
+			!memcmp( x.joypad,    y.joypad,    sizeof *x.joypad ) &&
+			!memcmp( x.apu,       y.apu,       sizeof *x.apu ) &&
+			!memcmp( x.ppu,       y.ppu,       sizeof *x.ppu ) &&
+			!memcmp( x.mapper,    y.mapper,    sizeof *x.mapper ) &&
+			!memcmp( x.ram,       y.ram,       x.ram_size ) &&
+			!memcmp( x.sram,      y.sram,      x.sram_max ) &&
+			!memcmp( x.spr_ram,   y.spr_ram,   x.spr_ram_size ) &&
+			!memcmp( x.nametable, y.nametable, x.nametable_max ) &&
+			!memcmp( x.chr,       y.chr,       x.chr_max );
+}
+
+// Fills block with the snapshots and input film has for the same frames
+static void fill_block( Nes_Film const& film, Nes_Film_Data const& data, int index, block_t* b )
+{
+	frame_count_t first = film.begin() + index * data.period();
+	for ( int j = 0; j < block_size; j++ )
+		copy_state( film.read_snapshot( first + j * film.period() ), &b->states [j] );
+	
+	for ( int n = 0; n < data.period(); n++ )
+	{
+		Nes_Film::joypad_t j = film.get_joypad( first + n );
+		b->joypads [0] [n] = j & 0xFF;
+		b->joypads [1] [n] = j >> 8 & 0xFF;
+	}
+}
+
+int main( int argc, char** argv )
+{
+	if ( argc < 2 )
+	{
+		fprintf( stderr, "usage: %s rom.nes [frame_count] [period]\n", argv [0] );
+		return EXIT_FAILURE;
+	}
+	int frame_count = (argc > 2 ? atoi( argv [2] ) : 18000);
+	int period = (argc > 3 ? atoi( argv [3] ) : 60);
+	
+	// film is declared first, so recorder is destroyed before it
+	static Nes_Film film;
+	static Nes_Recorder emu;
+	film.clear( period );
+	emu.set_film( &film );
+	bench_load( emu, argv [1] );
+	for ( int n = 0; n < frame_count; n++ )
+		bench_check( emu.emulate_frame( joypad( n ) ) );
+	
+	static Nes_Worker worker;
+	bench_check( worker.start() );
+	static Nes_Film_Data data;
+	data.clear( period );
+	data.set_worker( &worker );
+	
+	// only blocks whose snapshots were all recorded
+	int block_count = film.length() / data.period();
+	if ( !block_count )
+		bench_check( "Recording is shorter than one block" );
+	double block_bytes = offsetof (block_t,joypad0) + data.period() * 2;
+	double total_mb = block_bytes * block_count * 1e-6;
+	printf( "%d blocks of %.0f bytes (period %d)\n", block_count, block_bytes, period );
+	
+	int differ_count = 0;
+	static Nes_Film_Data::packing_t const packings [] = {
+		Nes_Film_Data::pack_lz,
+		Nes_Film_Data::pack_delta
+	};
+	static const char* const names [] = { "lz", "delta" };
+	printf( "packing  size    pack MB/s  unpack MB/s\n" );
+	for ( int p = 0; p < 2; p++ )
+	{
+		data.clear( period );
+		data.set_packing( packings [p] );
+		bench_check( data.resize( block_count ) );
+		
+		// includes copying snapshots in, done while earlier blocks are packing
+		double start = bench_now();
+		for ( int i = 0; i < block_count; i++ )
+		{
+			block_t* b = data.write( i );
+			if ( !b )
+				bench_check( "Out of memory" );
+			fill_block( film, data, i, b );
+		}
+		long packed_size = data.packed_size(); // waits for packing to finish
+		double pack_time = bench_now() - start;
+		
+		// last block is still unpacked, so read it first
+		start = bench_now();
+		for ( int i = block_count; i--; )
+			data.read( i );
+		double unpack_time = bench_now() - start;
+		
+		bool same = true;
+		for ( int i = 0; i < block_count; i++ )
+		{
+			block_t const& b = data.read( i );
+			for ( int j = 0; j < block_size; j++ )
+			{
+				frame_count_t time = film.begin() + i * data.period() + j * period;
+				if ( !same_state( b.states [j], film.read_snapshot( time ) ) )
+					same = false;
+			}
+		}
+		if ( !same )
+			differ_count++;
+		
+		printf( "%-7s %5.1f%% %10.0f %12.0f%s\n", names [p],
+				packed_size * 100.0 / (block_bytes * block_count),
+				total_mb / pack_time, total_mb * (block_count - 1) / block_count / unpack_time,
+				(same ? "" : "  OUTPUT DIFFERS") );
+	}
+	
+	return (differ_count ? EXIT_FAILURE : 0);
+}
@@ -5,21 +5,35 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "Nes_Emu.h"
+#include "Multi_Buffer.h"
 #include "fex/Data_Reader.h"
 #include "abstract_file.h"
 
 static Nes_Emu *emu;
+static Stereo_Buffer *sound_buf;
+
+// Interleaved stereo samples handed to frontend; holds all of sound_buf
+static int16_t *audio_buf;
+static long audio_buf_pairs;
+static long audio_rate;    // current output sample rate, 0 if not set yet
 
 void retro_init(void)
 {
    delete emu;
    emu = new Nes_Emu;
+   if (!sound_buf)
+      sound_buf = new Stereo_Buffer;
 }
 
 void retro_deinit(void)
 {
    delete emu;
    emu = 0;
+   delete sound_buf;
+   sound_buf = 0;
+   free(audio_buf);
+   audio_buf = 0;
+   audio_buf_pairs = 0;
 }
 
 unsigned retro_api_version(void)
@@ -42,7 +56,7 @@ void retro_get_system_info(struct retro_system_info *info)
 
 void retro_get_system_av_info(struct retro_system_av_info *info)
 {
-   const retro_system_timing timing = { Nes_Emu::frame_rate, 44100.0 };
+   const retro_system_timing timing = { Nes_Emu::frame_rate, (double) audio_rate };
    info->timing = timing;
 
    const retro_game_geometry geom = {
@@ -61,10 +75,21 @@ static retro_audio_sample_batch_t audio_batch_cb;
 static retro_environment_t environ_cb;
 static retro_input_poll_t input_poll_cb;
 static retro_input_state_t input_state_cb;
+static bool can_dupe;
+static unsigned pixel_depth; // 32 (XRGB8888) or 16 (RGB565)
+static bool video_invalid = true; // video_buffer doesn't hold previous frame
 
 void retro_set_environment(retro_environment_t cb)
 {
    environ_cb = cb;
+
+   static const struct retro_variable vars[] = {
+      { "quicknes_audio_rate", "Audio sample rate; 44100|48000|96000|22050|32000" },
+      { "quicknes_audio_quality", "Audio quality; default|high" },
+      { NULL, NULL },
+   };
+
+   cb(RETRO_ENVIRONMENT_SET_VARIABLES, (void*)vars);
 }
 
 void retro_set_audio_sample(retro_audio_sample_t cb)
@@ -92,6 +117,68 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
    video_cb = cb;
 }
 
+// Sound buffer only needs to hold one frame, since retro_run() hands all
+// samples to the frontend every frame
+static bool set_sample_rate(long rate)
+{
+   if (emu->set_sample_rate(rate, sound_buf))
+      return false;
+   emu->set_equalizer(emu->equalizer()); // treble filter depends on rate
+
+   long pairs = sound_buf->sample_rate() * sound_buf->length() / 1000 + 1;
+   if (pairs > audio_buf_pairs)
+   {
+      int16_t *p = (int16_t*) realloc(audio_buf, pairs * 2 * sizeof *audio_buf);
+      if (!p)
+         return false;
+      audio_buf = p;
+      audio_buf_pairs = pairs;
+   }
+   audio_rate = rate;
+   return true;
+}
+
+enum { timing_changed = 1 };
+
+// Returns which parts of retro_system_av_info changed
+static int check_variables(void)
+{
+   int changed = 0;
+   struct retro_variable var = { "quicknes_audio_rate", NULL };
+   long rate = 44100;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      rate = atol(var.value);
+   if (rate < 22050 || rate > 96000)
+      rate = 44100;
+
+   if (rate != audio_rate)
+   {
+      long old_rate = audio_rate;
+      if (set_sample_rate(rate))
+      {
+         if (old_rate)
+            changed |= timing_changed;
+      }
+      else if (old_rate)
+      {
+         set_sample_rate(old_rate);
+      }
+   }
+
+   var.key = "quicknes_audio_quality";
+   var.value = NULL;
+   Nes_Apu::quality_t quality = Nes_Apu::quality_default;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "high"))
+         quality = Nes_Apu::quality_high;
+   }
+   if (quality != emu->sound_quality())
+      emu->set_sound_quality(quality); // keeps previous quality if out of memory
+
+   return changed;
+}
+
 void retro_reset(void)
 {
    if (emu)
@@ -136,42 +223,58 @@ static void update_input(int pads[2])
 
 void retro_run(void)
 {
+   bool updated = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
+   {
+      int changed = check_variables();
+      struct retro_system_av_info info;
+      retro_get_system_av_info(&info);
+      if (changed & timing_changed)
+         environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &info);
+   }
+
    int pads[2] = {0};
    update_input(pads);
 
    emu->emulate_frame(pads[0], pads[1]);
    const Nes_Emu::frame_t &frame = emu->frame();
 
+   // Only convert scanlines that changed; the rest of video_buffer still holds
+   // the previous frame's conversion.
    static uint32_t video_buffer[Nes_Emu::image_width * Nes_Emu::image_height];
-
-   const uint8_t *in_pixels = frame.pixels;
-   uint32_t *out_pixels = video_buffer;
-
-   for (unsigned h = 0; h < Nes_Emu::image_height;
-         h++, in_pixels += frame.pitch, out_pixels += Nes_Emu::image_width)
+   unsigned width = Nes_Emu::image_width;
+   size_t pitch = width * (pixel_depth / 8);
+   bool rows_valid = !video_invalid;
+   video_invalid = false;
+
+   if (frame.unchanged && rows_valid && can_dupe)
+      video_cb(NULL, width, Nes_Emu::image_height, pitch);
+   else
    {
-      for (unsigned w = 0; w < Nes_Emu::image_width; w++)
+      const uint8_t *in_pixels = frame.pixels;
+      uint8_t *out_pixels = (uint8_t*)video_buffer;
+      const uint32_t *colors32 = pixel_depth == 32 ? emu->rgb32_palette() : NULL;
+      const uint16_t *colors16 = pixel_depth == 16 ? emu->rgb16_palette() : NULL;
+
+      for (unsigned h = 0; h < Nes_Emu::image_height;
+            h++, in_pixels += frame.pitch, out_pixels += pitch)
       {
-         unsigned col = frame.palette[in_pixels[w]];
-         const Nes_Emu::rgb_t& rgb = emu->nes_colors[col];
-         unsigned r = rgb.red;
-         unsigned g = rgb.green;
-         unsigned b = rgb.blue;
-         out_pixels[w] = (r << 16) | (g << 8) | (b << 0);
+         if (rows_valid && !(frame.changed_rows[h >> 5] >> (h & 31) & 1))
+            continue;
+
+         if (colors32)
+            for (unsigned w = 0; w < Nes_Emu::image_width; w++)
+               ((uint32_t*)out_pixels)[w] = colors32[in_pixels[w]];
+         else
+            for (unsigned w = 0; w < Nes_Emu::image_width; w++)
+               ((uint16_t*)out_pixels)[w] = colors16[in_pixels[w]];
       }
-   }
-
-   video_cb(video_buffer, Nes_Emu::image_width, Nes_Emu::image_height,
-         Nes_Emu::image_width * sizeof(uint32_t));
 
-   // Mono -> Stereo.
-   int16_t samples[2048];
-   long read_samples = emu->read_samples(samples, 2048);
-   int16_t out_samples[4096];
-   for (long i = 0; i < read_samples; i++)
-      out_samples[(i << 1)] = out_samples[(i << 1) + 1] = samples[i];
+      video_cb(video_buffer, width, Nes_Emu::image_height, pitch);
+   }
 
-   audio_batch_cb(out_samples, read_samples);
+   long pairs = emu->read_stereo_samples(audio_buf, audio_buf_pairs);
+   audio_batch_cb(audio_buf, pairs);
 }
 
 bool retro_load_game(const struct retro_game_info *info)
@@ -222,18 +325,33 @@ bool retro_load_game(const struct retro_game_info *info)
    environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, desc);
 
    enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+   pixel_depth = 32;
    if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
    {
-      fprintf(stderr, "XRGB8888 is not supported.\n");
-      return false;
+      fmt = RETRO_PIXEL_FORMAT_RGB565;
+      pixel_depth = 16;
+      if (!environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt))
+      {
+         fprintf(stderr, "Neither XRGB8888 nor RGB565 is supported.\n");
+         return false;
+      }
    }
 
-   emu->set_sample_rate(44100);
+   can_dupe = false;
+   environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe);
+
    emu->set_equalizer(Nes_Emu::nes_eq);
    emu->set_palette_range(0);
 
-   static uint8_t video_buffer[Nes_Emu::image_width * Nes_Emu::image_height];
-   emu->set_pixels(video_buffer, Nes_Emu::image_width);
+   // PPU draws junk past both sides of each row and uses one row above the image,
+   // so the buffer must be full width and a little taller than the image
+   static uint8_t video_buffer[Nes_Emu::buffer_width * (Nes_Emu::image_height + 2)];
+   emu->set_pixels(video_buffer, Nes_Emu::buffer_width);
+
+   audio_rate = 0;
+   check_variables();
+   if (!audio_rate)
+      return false;
 
    Mem_File_Reader reader(info->data, info->size);
    return !emu->load_ines(reader);
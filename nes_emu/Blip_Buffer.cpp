@@ -167,8 +167,9 @@ void Blip_Buffer::remove_samples( long count )
 
 // Blip_Synth_
 
-Blip_Synth_::Blip_Synth_( short* p, int w ) :
+Blip_Synth_::Blip_Synth_( short* p, int w, blip_long* k ) :
 	impulses( p ),
+	kernels( k ),
 	width( w )
 {
 	volume_unit_ = 0.0;
@@ -250,11 +251,31 @@ void Blip_Synth_::adjust_impulse()
 		//printf( "error: %ld\n", error );
 	}
 	
+	update_kernels();
+	
 	//for ( int i = blip_res; i--; printf( "\n" ) )
 	//  for ( int j = 0; j < width / 2; j++ )
 	//      printf( "%5ld,", impulses [j * blip_res + i + 1] );
 }
 
+void Blip_Synth_::update_kernels()
+{
+	#if BLIP_BUFFER_SIMD
+		// first half runs forward from impulses [blip_res - phase], second half
+		// runs backward to impulses [phase]
+		int const half = width / 2;
+		for ( int phase = 0; phase < blip_res; phase++ )
+		{
+			blip_long* out = kernels + phase * width;
+			for ( int i = 0; i < half; i++ )
+			{
+				out [i] = impulses [blip_res - phase + blip_res * i];
+				out [width - 1 - i] = impulses [phase + blip_res * i];
+			}
+		}
+	#endif
+}
+
 void Blip_Synth_::treble_eq( blip_eq_t const& eq )
 {
 	float fimpulse [blip_res / 2 * (blip_widest_impulse_ - 1) + blip_res * 2];
@@ -353,47 +374,120 @@ long Blip_Buffer::read_samples( blip_sample_t* out, long max_samples, int stereo
 	
 	if ( count )
 	{
-		int const sample_shift = blip_sample_bits - 16;
-		int const bass_shift = this->bass_shift;
-		long accum = reader_accum;
-		buf_t_* in = buffer_;
+		Blip_Reader reader;
+		int const bass_shift = reader.begin( *this );
+		blip_long block [blip_block_size];
 		
-		if ( !stereo )
+		for ( long remain = count; remain; )
 		{
-			for ( long n = count; n--; )
+			int n = blip_block_size;
+			if ( n > remain )
+				n = (int) remain;
+			remain -= n;
+			
+			reader.read_block( block, n, bass_shift );
+			if ( !stereo )
 			{
-				long s = accum >> sample_shift;
-				accum -= accum >> bass_shift;
-				accum += *in++;
-				*out++ = (blip_sample_t) s;
-				
-				// clamp sample
-				if ( (blip_sample_t) s != s )
-					out [-1] = (blip_sample_t) (0x7FFF - (s >> 24));
+				blip_pack_mono( out, block, n );
+				out += n;
 			}
-		}
-		else
-		{
-			for ( long n = count; n--; )
+			else
 			{
-				long s = accum >> sample_shift;
-				accum -= accum >> bass_shift;
-				accum += *in++;
-				*out = (blip_sample_t) s;
-				out += 2;
-				
-				// clamp sample
-				if ( (blip_sample_t) s != s )
-					out [-2] = (blip_sample_t) (0x7FFF - (s >> 24));
+				for ( int i = 0; i < n; i++ )
+				{
+					blip_long s = block [i];
+					*out = (blip_sample_t) s;
+					out += 2;
+					
+					// clamp sample
+					if ( (blip_sample_t) s != s )
+						out [-2] = (blip_sample_t) (0x7FFF - (s >> 24));
+				}
 			}
 		}
 		
-		reader_accum = accum;
+		reader.end( *this );
 		remove_samples( count );
 	}
 	return count;
 }
 
+// Block reading
+
+void Blip_Reader::read_block( blip_long* out, int count, int bass_shift )
+{
+	assert( (unsigned) count <= (unsigned) blip_block_size );
+	
+	int const sample_shift = blip_sample_bits - 16;
+	Blip_Buffer::buf_t_ const* in = buf;
+	long accum = this->accum;
+	for ( int n = count; n--; )
+	{
+		*out++ = (blip_long) (accum >> sample_shift);
+		accum += *in++ - (accum >> bass_shift);
+	}
+	buf = in;
+	this->accum = accum;
+}
+
+void blip_mix_block( blip_long* out, blip_long const* in, int count )
+{
+	int i = 0;
+	#if BLIP_BUFFER_SIMD
+		for ( ; i + 4 <= count; i += 4 )
+		{
+			__m128i a = _mm_loadu_si128( (__m128i const*) (out + i) );
+			__m128i b = _mm_loadu_si128( (__m128i const*) (in  + i) );
+			_mm_storeu_si128( (__m128i*) (out + i), _mm_add_epi32( a, b ) );
+		}
+	#endif
+	for ( ; i < count; i++ )
+		out [i] += in [i];
+}
+
+static inline blip_sample_t clamp_sample( blip_long s )
+{
+	if ( (blip_sample_t) s != s )
+		s = 0x7FFF - (s >> 24);
+	return (blip_sample_t) s;
+}
+
+void blip_pack_mono( blip_sample_t* out, blip_long const* in, int count )
+{
+	int i = 0;
+	#if BLIP_BUFFER_SIMD
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i lo = _mm_loadu_si128( (__m128i const*) (in + i) );
+			__m128i hi = _mm_loadu_si128( (__m128i const*) (in + i + 4) );
+			_mm_storeu_si128( (__m128i*) (out + i), _mm_packs_epi32( lo, hi ) );
+		}
+	#endif
+	for ( ; i < count; i++ )
+		out [i] = clamp_sample( in [i] );
+}
+
+void blip_pack_stereo( blip_sample_t* out, blip_long const* left, blip_long const* right, int count )
+{
+	int i = 0;
+	#if BLIP_BUFFER_SIMD
+		for ( ; i + 8 <= count; i += 8 )
+		{
+			__m128i l = _mm_packs_epi32( _mm_loadu_si128( (__m128i const*) (left + i) ),
+					_mm_loadu_si128( (__m128i const*) (left + i + 4) ) );
+			__m128i r = _mm_packs_epi32( _mm_loadu_si128( (__m128i const*) (right + i) ),
+					_mm_loadu_si128( (__m128i const*) (right + i + 4) ) );
+			_mm_storeu_si128( (__m128i*) (out + i * 2    ), _mm_unpacklo_epi16( l, r ) );
+			_mm_storeu_si128( (__m128i*) (out + i * 2 + 8), _mm_unpackhi_epi16( l, r ) );
+		}
+	#endif
+	for ( ; i < count; i++ )
+	{
+		out [i * 2    ] = clamp_sample( left  [i] );
+		out [i * 2 + 1] = clamp_sample( right [i] );
+	}
+}
+
 void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 {
 	buf_t_* out = buffer_ + (offset_ >> BLIP_BUFFER_ACCURACY) + blip_widest_impulse_ / 2;
@@ -6,6 +6,8 @@
 #ifndef BLIP_BUFFER_H
 #define BLIP_BUFFER_H
 
+#include <limits.h>
+
 // Time unit at source clock rate
 typedef long blip_time_t;
 
@@ -13,6 +15,13 @@ typedef long blip_time_t;
 typedef short blip_sample_t;
 enum { blip_sample_max = 32767 };
 
+// Sample in block being mixed; at least 32 bits
+#if INT_MAX < 0x7FFFFFFF
+	typedef long blip_long;
+#else
+	typedef int blip_long;
+#endif
+
 class Blip_Buffer {
 public:
 	typedef const char* blargg_err_t;
@@ -95,7 +104,7 @@ private:
 	Blip_Buffer( const Blip_Buffer& );
 	Blip_Buffer& operator = ( const Blip_Buffer& );
 public:
-	typedef long buf_t_;
+	typedef blip_long buf_t_;
 	unsigned long factor_;
 	blip_resampled_time_t offset_;
 	buf_t_* buffer_;
@@ -127,6 +136,20 @@ private:
 	#define BLIP_PHASE_BITS 6
 #endif
 
+// BLIP_BUFFER_SIMD: If non-zero, use SSE2 to add impulses and to mix and convert
+// blocks of samples. Defaults to enabled when compiler targets SSE2.
+#ifndef BLIP_BUFFER_SIMD
+	#ifdef __SSE2__
+		#define BLIP_BUFFER_SIMD 1
+	#else
+		#define BLIP_BUFFER_SIMD 0
+	#endif
+#endif
+
+#if BLIP_BUFFER_SIMD
+	#include <emmintrin.h>
+#endif
+
 	// Internal
 	typedef unsigned long blip_resampled_time_t;
 	int const blip_widest_impulse_ = 16;
@@ -136,16 +159,18 @@ private:
 	class Blip_Synth_ {
 		double volume_unit_;
 		short* const impulses;
+		blip_long* const kernels;
 		int const width;
 		long kernel_unit;
 		int impulses_size() const { return blip_res / 2 * width + 1; }
 		void adjust_impulse();
+		void update_kernels();
 	public:
 		Blip_Buffer* buf;
 		int last_amp;
 		int delta_factor;
 		
-		Blip_Synth_( short* impulses, int width );
+		Blip_Synth_( short* impulses, int width, blip_long* kernels );
 		void treble_eq( blip_eq_t const& );
 		void volume_unit( double );
 	};
@@ -195,10 +220,14 @@ public:
 	}
 	
 public:
-	Blip_Synth() : impl( impulses, quality ) { }
+	Blip_Synth() : impl( impulses, quality, kernels ) { }
 private:
 	typedef short imp_t;
 	imp_t impulses [blip_res * (quality / 2) + 1];
+	
+	// Impulse for each phase, in buffer order (used by SIMD version)
+	blip_long kernels [BLIP_BUFFER_SIMD ? blip_res * quality : 1];
+	
 	Blip_Synth_ impl;
 };
 
@@ -239,6 +268,11 @@ public:
 	// Advance to next sample
 	void next( int bass_shift = 9 )         { accum += *buf++ - (accum >> bass_shift); }
 	
+	// Read next count samples (at most blip_block_size) into out, at the same scale
+	// as read(). Separates integration from mixing and conversion, which can then
+	// be done a block at a time (see blip_pack_mono()).
+	void read_block( blip_long* out, int count, int bass_shift = 9 );
+	
 	// End reading samples from buffer. The number of samples read must now be removed
 	// using Blip_Buffer::remove_samples().
 	void end( Blip_Buffer& b )              { b.reader_accum = accum; }
@@ -248,6 +282,17 @@ private:
 	long accum;
 };
 
+// Maximum number of samples handled by one block operation
+int const blip_block_size = 256;
+
+// Add count samples from in to out
+void blip_mix_block( blip_long* out, blip_long const* in, int count );
+
+// Convert count samples to 16-bit output, clamping any that are out of range.
+// Stereo version interleaves left and right.
+void blip_pack_mono( blip_sample_t* out, blip_long const* in, int count );
+void blip_pack_stereo( blip_sample_t* out, blip_long const* left, blip_long const* right, int count );
+
 
 // End of public interface
 
@@ -282,11 +327,31 @@ inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t t
 	assert( (long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
 	delta *= impl.delta_factor;
 	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
+	Blip_Buffer::buf_t_* buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
+	
+	int const fwd = (blip_widest_impulse_ - quality) / 2;
+	
+#if BLIP_BUFFER_SIMD
+	// buf [fwd + i] += kernel [i] * delta, four at a time
+	blip_long const* kernel = kernels + phase * quality;
+	buf += fwd;
+	__m128i const d = _mm_set1_epi32( delta );
+	for ( int i = 0; i < quality; i += 4 )
+	{
+		// 32-bit multiply using even and odd lanes
+		__m128i k = _mm_loadu_si128( (__m128i const*) (kernel + i) );
+		__m128i even = _mm_mul_epu32( k, d );
+		__m128i odd  = _mm_mul_epu32( _mm_srli_epi64( k, 32 ), d );
+		__m128i prod = _mm_unpacklo_epi32( _mm_shuffle_epi32( even, 0x08 ),
+				_mm_shuffle_epi32( odd, 0x08 ) );
+		
+		__m128i* out = (__m128i*) (buf + i);
+		_mm_storeu_si128( out, _mm_add_epi32( _mm_loadu_si128( out ), prod ) );
+	}
+#else
 	imp_t const* imp = impulses + blip_res - phase;
-	long* buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
 	long i0 = *imp;
 	
-	int const fwd = (blip_widest_impulse_ - quality) / 2;
 	int const rev = fwd + quality - 2;
 	
 	BLIP_FWD( 0 )
@@ -309,6 +374,7 @@ inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t t
 	long t1 = *imp * delta + buf [rev + 1];
 	buf [rev] = t0;
 	buf [rev + 1] = t1;
+#endif
 }
 
 #undef BLIP_FWD
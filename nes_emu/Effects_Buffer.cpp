@@ -77,6 +77,7 @@ Effects_Buffer::Effects_Buffer( bool center_only ) : Multi_Buffer( 2 )
 	stereo_remain = 0;
 	effect_remain = 0;
 	effects_enabled = false;
+	plain_mix = false;
 	set_depth( 0 );
 }
 
@@ -182,6 +183,19 @@ void Effects_Buffer::config( const config_t& cfg )
 		chans.echo_delay_r = pin_range( echo_size - 1 - (echo_sample_delay + delay_offset),
 				echo_size - 1 );
 		
+		// Centered pans without echo or reverb can use a simpler mixer. Echo and
+		// reverb buffers are cleared when switching so that they match what the
+		// simpler mixer doesn't keep.
+		bool plain = !chans.echo_level && !chans.reverb_level &&
+				chans.pan_1_levels [0] == TO_FIXED( 1 ) &&
+				chans.pan_2_levels [0] == TO_FIXED( 1 );
+		if ( plain != plain_mix && echo_buf )
+		{
+			memset( echo_buf, 0, echo_size * sizeof (blip_sample_t) );
+			memset( reverb_buf, 0, reverb_size * sizeof (blip_sample_t) );
+		}
+		plain_mix = plain;
+		
 		// set up outputs
 		for ( unsigned i = 0; i < chan_count; i++ )
 		{
@@ -264,11 +278,17 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 			
 			if ( stereo_remain )
 			{
-				mix_enhanced( out, count );
+				if ( plain_mix )
+					mix_plain( out, count, true );
+				else
+					mix_enhanced( out, count );
 			}
 			else
 			{
-				mix_mono_enhanced( out, count );
+				if ( plain_mix )
+					mix_plain( out, count, false );
+				else
+					mix_mono_enhanced( out, count );
 				active_bufs = 3;
 			}
 		}
@@ -308,76 +328,62 @@ long Effects_Buffer::read_samples( blip_sample_t* out, long total_samples )
 
 void Effects_Buffer::mix_mono( blip_sample_t* out, long count )
 {
-	Blip_Reader c;
-	int shift = c.begin( bufs [0] );
-	
-	// unrolled loop
-	for ( long n = count >> 1; n--; )
-	{
-		long cs0 = c.read();
-		c.next( shift );
-		
-		long cs1 = c.read();
-		c.next( shift );
-		
-		if ( (BOOST::int16_t) cs0 != cs0 )
-			cs0 = 0x7FFF - (cs0 >> 24);
-		((BOOST::uint32_t*) out) [0] = ((BOOST::uint16_t) cs0) | (cs0 << 16);
-		
-		if ( (BOOST::int16_t) cs1 != cs1 )
-			cs1 = 0x7FFF - (cs1 >> 24);
-		((BOOST::uint32_t*) out) [1] = ((BOOST::uint16_t) cs1) | (cs1 << 16);
-		out += 4;
-	}
-	
-	if ( count & 1 )
-	{
-		int s = c.read();
-		c.next( shift );
-		out [0] = s;
-		out [1] = s;
-		if ( (BOOST::int16_t) s != s )
-		{
-			s = 0x7FFF - (s >> 24);
-			out [0] = s;
-			out [1] = s;
-		}
-	}
-	
-	c.end( bufs [0] );
+	mix_blocks( out, count, bufs [0] );
 }
 
 void Effects_Buffer::mix_stereo( blip_sample_t* out, long count )
 {
-	Blip_Reader l; l.begin( bufs [1] );
-	Blip_Reader r; r.begin( bufs [2] );
-	Blip_Reader c;
-	int shift = c.begin( bufs [0] );
+	mix_blocks( out, count, bufs [0], &bufs [1], &bufs [2] );
+}
+
+void Effects_Buffer::mix_plain( blip_sample_t* out, long count, bool stereo )
+{
+	// Same result as mix_enhanced() and mix_mono_enhanced() when pans are centered
+	// and echo and reverb are off (FMUL( s, TO_FIXED( 1 ) ) == s), but the buffers
+	// are simply added a block at a time.
+	int const used = stereo ? max_buf_count : 3;
+	Blip_Reader readers [max_buf_count];
+	int bass = readers [2].begin( bufs [2] );
+	for ( int i = 0; i < used; i++ )
+		if ( i != 2 )
+			readers [i].begin( bufs [i] );
 	
-	while ( count-- )
+	blip_long left [blip_block_size];
+	blip_long right [blip_block_size];
+	blip_long temp [blip_block_size];
+	while ( count )
 	{
-		int cs = c.read();
-		c.next( shift );
-		int left = cs + l.read();
-		int right = cs + r.read();
-		l.next( shift );
-		r.next( shift );
-		
-		if ( (BOOST::int16_t) left != left )
-			left = 0x7FFF - (left >> 24);
-		
-		out [0] = left;
-		out [1] = right;
-		
-		out += 2;
-		
-		if ( (BOOST::int16_t) right != right )
-			out [-1] = 0x7FFF - (right >> 24);
+		int n = blip_block_size;
+		if ( n > count )
+			n = (int) count;
+		count -= n;
+		
+		// squares and center
+		readers [0].read_block( left, n, bass );
+		readers [1].read_block( temp, n, bass );
+		blip_mix_block( left, temp, n );
+		readers [2].read_block( temp, n, bass );
+		blip_mix_block( left, temp, n );
+		
+		if ( !stereo )
+		{
+			blip_pack_stereo( out, left, left, n );
+		}
+		else
+		{
+			memcpy( right, left, n * sizeof *right );
+			for ( int i = 3; i < max_buf_count; i++ )
+			{
+				readers [i].read_block( temp, n, bass );
+				blip_mix_block( (i & 1) ? left : right, temp, n );
+			}
+			blip_pack_stereo( out, left, right, n );
+		}
+		out += n * 2;
 	}
 	
-	c.end( bufs [0] );
-	r.end( bufs [2] );
-	l.end( bufs [1] );
+	for ( int i = 0; i < used; i++ )
+		readers [i].end( bufs [i] );
 }
 
 void Effects_Buffer::mix_mono_enhanced( blip_sample_t* out, long count )
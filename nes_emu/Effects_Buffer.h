@@ -62,6 +62,7 @@ private:
 	long effect_remain;
 	int buf_count;
 	bool effects_enabled;
+	bool plain_mix; // effects are configured to have no audible effect
 	
 	blip_sample_t* reverb_buf;
 	blip_sample_t* echo_buf;
@@ -83,6 +84,7 @@ private:
 	void mix_stereo( blip_sample_t*, long );
 	void mix_enhanced( blip_sample_t*, long );
 	void mix_mono_enhanced( blip_sample_t*, long );
+	void mix_plain( blip_sample_t*, long, bool stereo );
 };
 
 	inline Effects_Buffer::channel_t Effects_Buffer::channel( int i ) {
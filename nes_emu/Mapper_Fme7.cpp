@@ -72,6 +72,7 @@ public:
 		sound.save_state( &sound_state );
 		fme7_state_t::swap();
 		Nes_Mapper::save_state( out );
+		out.sound_offset = offsetof (fme7_state_t,sound_state);
 		fme7_state_t::swap(); // to do: kind of hacky to swap in place
 	}
 	
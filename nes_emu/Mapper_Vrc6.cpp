@@ -82,6 +82,7 @@ public:
 		sound.save_state( &sound_state );
 		vrc6_state_t::swap();
 		Nes_Mapper::save_state( out );
+		out.sound_offset = offsetof (vrc6_state_t,sound_state);
 		vrc6_state_t::swap(); // to do: kind of hacky to swap in place
 	}
 	
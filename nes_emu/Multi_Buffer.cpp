@@ -155,59 +155,58 @@ long Stereo_Buffer::read_samples( blip_sample_t* out, long count )
 
 void Stereo_Buffer::mix_stereo( blip_sample_t* out, long count )
 {
-	Blip_Reader left; 
-	Blip_Reader right; 
-	Blip_Reader center;
-	
-	left.begin( bufs [1] );
-	right.begin( bufs [2] );
-	int bass = center.begin( bufs [0] );
-	
-	while ( count-- )
-	{
-		int c = center.read();
-		long l = c + left.read();
-		long r = c + right.read();
-		center.next( bass );
-		out [0] = l;
-		out [1] = r;
-		out += 2;
-		
-		if ( (BOOST::int16_t) l != l )
-			out [-2] = 0x7FFF - (l >> 24);
-		
-		left.next( bass );
-		right.next( bass );
-		
-		if ( (BOOST::int16_t) r != r )
-			out [-1] = 0x7FFF - (r >> 24);
-	}
-	
-	center.end( bufs [0] );
-	right.end( bufs [2] );
-	left.end( bufs [1] );
+	mix_blocks( out, count, bufs [0], &bufs [1], &bufs [2] );
 }
 
 void Stereo_Buffer::mix_mono( blip_sample_t* out, long count )
 {
-	Blip_Reader in;
-	int bass = in.begin( bufs [0] );
+	mix_blocks( out, count, bufs [0] );
+}
+
+void Multi_Buffer::mix_blocks( blip_sample_t* out, long count, Blip_Buffer& center,
+		Blip_Buffer* left, Blip_Buffer* right )
+{
+	Blip_Reader c;
+	Blip_Reader l;
+	Blip_Reader r;
+	int bass = c.begin( center );
+	if ( left )
+	{
+		l.begin( *left );
+		r.begin( *right );
+	}
 	
-	while ( count-- )
+	blip_long cs [blip_block_size];
+	blip_long ls [blip_block_size];
+	blip_long rs [blip_block_size];
+	while ( count )
 	{
-		long s = in.read();
-		in.next( bass );
-		out [0] = s;
-		out [1] = s;
-		out += 2;
+		int n = blip_block_size;
+		if ( n > count )
+			n = (int) count;
+		count -= n;
 		
-		if ( (BOOST::int16_t) s != s ) {
-			s = 0x7FFF - (s >> 24);
-			out [-2] = s;
-			out [-1] = s;
+		c.read_block( cs, n, bass );
+		if ( !left )
+		{
+			blip_pack_stereo( out, cs, cs, n );
 		}
+		else
+		{
+			l.read_block( ls, n, bass );
+			r.read_block( rs, n, bass );
+			blip_mix_block( ls, cs, n );
+			blip_mix_block( rs, cs, n );
+			blip_pack_stereo( out, ls, rs, n );
+		}
+		out += n * 2;
 	}
 	
-	in.end( bufs [0] );
+	c.end( center );
+	if ( left )
+	{
+		r.end( *right );
+		l.end( *left );
+	}
 }
 
@@ -55,6 +55,15 @@ public:
 	
 protected:
 	void channels_changed() { channels_changed_count_++; }
+	
+	// For buffers whose output frame size depends on the channel count
+	void set_samples_per_frame( int n ) { samples_per_frame_ = n; }
+	
+	// Read count samples from center, left, and right buffers, mixing center
+	// into both sides and writing interleaved stereo output. If left is NULL,
+	// writes center to both sides. Doesn't remove samples from buffers.
+	static void mix_blocks( blip_sample_t* out, long count, Blip_Buffer& center,
+			Blip_Buffer* left = NULL, Blip_Buffer* right = NULL );
 private:
 	// noncopyable
 	Multi_Buffer( const Multi_Buffer& );
@@ -63,7 +72,7 @@ private:
 	unsigned channels_changed_count_;
 	long sample_rate_;
 	int length_;
-	int const samples_per_frame_;
+	int samples_per_frame_;
 };
 
 // Uses a single buffer and outputs mono samples.
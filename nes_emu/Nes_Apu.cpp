@@ -19,12 +19,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 int const amp_range = 15;
 
 Nes_Apu::Nes_Apu() :
-	square1( &square_synth ),
-	square2( &square_synth )
+	treble_eq_( -8.0 ) // same as Blip_Synth's default
 {
 	dmc.apu = this;
 	dmc.prg_reader = NULL;
 	irq_notifier_ = NULL;
+	fast_synths = NULL;
+	high_synths = NULL;
+	quality_ = quality_default;
 	
 	oscs [0] = &square1;
 	oscs [1] = &square2;
@@ -39,25 +41,85 @@ Nes_Apu::Nes_Apu() :
 
 Nes_Apu::~Nes_Apu()
 {
+	delete fast_synths;
+	delete high_synths;
+}
+
+blargg_err_t Nes_Apu::set_quality( quality_t q )
+{
+	if ( q == quality_fast && !fast_synths )
+		CHECK_ALLOC( fast_synths = BLARGG_NEW fast_synths_t );
+	
+	if ( q == quality_high && !high_synths )
+		CHECK_ALLOC( high_synths = BLARGG_NEW high_synths_t );
+	
+	// synthesizers don't get settings while unused, so bring them up to date
+	quality_ = q;
+	treble_eq( treble_eq_ );
+	update_volume();
+	
+	// oscillators keep their amplitudes and all steps are centered the same,
+	// so switching mid-frame doesn't click
+	return 0;
+}
+
+template<class S>
+void Nes_Apu::set_treble_eq( S& s )
+{
+	s.square.treble_eq( treble_eq_ );
+	s.triangle.treble_eq( treble_eq_ );
+	s.noise.treble_eq( treble_eq_ );
+	s.dmc.treble_eq( treble_eq_ );
 }
 
 void Nes_Apu::treble_eq( const blip_eq_t& eq )
 {
-	square_synth.treble_eq( eq );
-	triangle.synth.treble_eq( eq );
-	noise.synth.treble_eq( eq );
-	dmc.synth.treble_eq( eq );
+	treble_eq_ = eq;
+	switch ( quality_ )
+	{
+		case quality_fast: set_treble_eq( *fast_synths ); break;
+		case quality_high: set_treble_eq( *high_synths ); break;
+		default:           set_treble_eq( default_synths ); break;
+	}
+}
+
+template<class S>
+void Nes_Apu::set_volume( S& s )
+{
+	double const v = volume_;
+	if ( dmc.nonlinear )
+	{
+		s.square.volume( 1.3 * 0.25751258 / 0.742467605 * 0.25 / amp_range * v );
+		
+		const double tnd = 0.48 / 202 * nonlinear_tnd_gain();
+		s.triangle.volume( 3.0 * tnd );
+		s.noise.volume( 2.0 * tnd );
+		s.dmc.volume( tnd );
+	}
+	else
+	{
+		s.square.volume(   0.1128  / amp_range * v );
+		s.triangle.volume( 0.12765 / amp_range * v );
+		s.noise.volume(    0.0741  / amp_range * v );
+		s.dmc.volume(      0.42545 / 127 * v );
+	}
+}
+
+void Nes_Apu::update_volume()
+{
+	switch ( quality_ )
+	{
+		case quality_fast: set_volume( *fast_synths ); break;
+		case quality_high: set_volume( *high_synths ); break;
+		default:           set_volume( default_synths ); break;
+	}
 }
 
 void Nes_Apu::enable_nonlinear( double v )
 {
 	dmc.nonlinear = true;
-	square_synth.volume( 1.3 * 0.25751258 / 0.742467605 * 0.25 / amp_range * v );
-	
-	const double tnd = 0.48 / 202 * nonlinear_tnd_gain();
-	triangle.synth.volume( 3.0 * tnd );
-	noise.synth.volume( 2.0 * tnd );
-	dmc.synth.volume( tnd );
+	volume_ = v;
+	update_volume();
 	
 	square1 .last_amp = 0;
 	square2 .last_amp = 0;
@@ -69,10 +131,8 @@ void Nes_Apu::enable_nonlinear( double v )
 void Nes_Apu::volume( double v )
 {
 	dmc.nonlinear = false;
-	square_synth.volume(   0.1128  / amp_range * v );
-	triangle.synth.volume( 0.12765 / amp_range * v );
-	noise.synth.volume(    0.0741  / amp_range * v );
-	dmc.synth.volume(      0.42545 / 127 * v );
+	volume_ = v;
+	update_volume();
 }
 
 void Nes_Apu::output( Blip_Buffer* buffer )
@@ -131,6 +191,16 @@ void Nes_Apu::irq_changed()
 
 // frames
 
+void Nes_Apu::run_dmc( nes_time_t time, nes_time_t end_time )
+{
+	switch ( quality_ )
+	{
+		case quality_fast: dmc.run( fast_synths->dmc, time, end_time ); break;
+		case quality_high: dmc.run( high_synths->dmc, time, end_time ); break;
+		default:           dmc.run( default_synths.dmc, time, end_time ); break;
+	}
+}
+
 void Nes_Apu::run_until( nes_time_t end_time )
 {
 	require( end_time >= last_dmc_time );
@@ -138,7 +208,7 @@ void Nes_Apu::run_until( nes_time_t end_time )
 	{
 		nes_time_t start = last_dmc_time;
 		last_dmc_time = end_time;
-		dmc.run( start, end_time );
+		run_dmc( start, end_time );
 	}
 }
 
@@ -149,11 +219,22 @@ void Nes_Apu::run_until_( nes_time_t end_time )
 	if ( end_time == last_time )
 		return;
 	
+	switch ( quality_ )
+	{
+		case quality_fast: run_until_( *fast_synths, end_time ); break;
+		case quality_high: run_until_( *high_synths, end_time ); break;
+		default:           run_until_( default_synths, end_time ); break;
+	}
+}
+
+template<class S>
+void Nes_Apu::run_until_( S const& synths, nes_time_t end_time )
+{
 	if ( last_dmc_time < end_time )
 	{
 		nes_time_t start = last_dmc_time;
 		last_dmc_time = end_time;
-		dmc.run( start, end_time );
+		dmc.run( synths.dmc, start, end_time );
 	}
 	
 	while ( true )
@@ -165,10 +246,10 @@ void Nes_Apu::run_until_( nes_time_t end_time )
 		frame_delay -= time - last_time;
 		
 		// run oscs to present
-		square1.run( last_time, time );
-		square2.run( last_time, time );
-		triangle.run( last_time, time );
-		noise.run( last_time, time );
+		square1.run( synths.square, last_time, time );
+		square2.run( synths.square, last_time, time );
+		triangle.run( synths.triangle, last_time, time );
+		noise.run( synths.noise, last_time, time );
 		last_time = time;
 		
 		if ( time == end_time )
@@ -217,14 +298,24 @@ void Nes_Apu::run_until_( nes_time_t end_time )
 	}
 }
 
-template<class T>
-inline void zero_apu_osc( T* osc, nes_time_t time )
+template<class T,class Synth>
+inline void zero_apu_osc( T* osc, Synth const& synth, nes_time_t time )
 {
 	Blip_Buffer* output = osc->output;
 	int last_amp = osc->last_amp;
 	osc->last_amp = 0;
 	if ( output && last_amp )
-		osc->synth.offset( time, -last_amp, output );
+		synth.offset( time, -last_amp, output );
+}
+
+template<class S>
+void Nes_Apu::zero_oscs( S const& synths, nes_time_t time )
+{
+	zero_apu_osc( &square1,  synths.square,   time );
+	zero_apu_osc( &square2,  synths.square,   time );
+	zero_apu_osc( &triangle, synths.triangle, time );
+	zero_apu_osc( &noise,    synths.noise,    time );
+	zero_apu_osc( &dmc,      synths.dmc,      time );
 }
 
 void Nes_Apu::end_frame( nes_time_t end_time )
@@ -234,11 +325,12 @@ void Nes_Apu::end_frame( nes_time_t end_time )
 	
 	if ( dmc.nonlinear )
 	{
-		zero_apu_osc( &square1,  last_time );
-		zero_apu_osc( &square2,  last_time );
-		zero_apu_osc( &triangle, last_time );
-		zero_apu_osc( &noise,    last_time );
-		zero_apu_osc( &dmc,      last_time );
+		switch ( quality_ )
+		{
+			case quality_fast: zero_oscs( *fast_synths, last_time ); break;
+			case quality_high: zero_oscs( *high_synths, last_time ); break;
+			default:           zero_oscs( default_synths, last_time ); break;
+		}
 	}
 	
 	// make times relative to new frame
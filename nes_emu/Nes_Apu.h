@@ -63,6 +63,22 @@ public:
 	// Set treble equalization (see notes.txt)
 	void treble_eq( const blip_eq_t& );
 	
+	// Synthesis quality tiers. Lower tiers use narrower band-limited steps, which
+	// let more aliasing through. Narrow steps save little CPU time, since most of
+	// it is spent outside synthesis.
+	enum quality_t {
+		quality_fast,    // narrow steps for all oscillators
+		quality_default, // wider steps for squares
+		quality_high     // widest steps for all oscillators
+	};
+	
+	// Set synthesis quality (default is quality_default). Takes effect immediately
+	// and without a click, so it can be changed during play.
+	blargg_err_t set_quality( quality_t );
+	
+	// Current synthesis quality
+	quality_t quality() const { return quality_; }
+	
 	// Set sound output of specific oscillator to buffer. If buffer is NULL,
 	// the specified oscillator is muted and emulation accuracy is reduced.
 	// The oscillators are indexed as follows: 0) Square 1, 1) Square 2,
@@ -125,11 +141,27 @@ private:
 	bool irq_flag;
 	void (*irq_notifier_)( void* user_data );
 	void* irq_data;
-	Nes_Square::Synth square_synth; // shared by squares
+	
+	// synthesizers for each quality tier; others are allocated when first used
+	typedef Nes_Osc_Synths<blip_med_quality,blip_med_quality>   fast_synths_t;
+	typedef Nes_Osc_Synths<blip_good_quality,blip_med_quality>  default_synths_t;
+	typedef Nes_Osc_Synths<blip_high_quality,blip_high_quality> high_synths_t;
+	default_synths_t default_synths;
+	fast_synths_t* fast_synths;
+	high_synths_t* high_synths;
+	quality_t quality_;
+	blip_eq_t treble_eq_;
+	double volume_;
 	
 	void irq_changed();
 	void state_restored();
 	void run_until_( nes_time_t );
+	void run_dmc( nes_time_t, nes_time_t );
+	void update_volume();
+	template<class S> void run_until_( S const&, nes_time_t );
+	template<class S> void zero_oscs( S const&, nes_time_t );
+	template<class S> void set_volume( S& );
+	template<class S> void set_treble_eq( S& );
 	
 	// TODO: remove
 	friend class Nes_Core;
@@ -1,47 +1,160 @@
 
 #include "Nes_Blitter.h"
 
+#include <string.h>
 #include "blargg_endian.h"
 
-#include "blargg_source.h"
-
+// Default output depth (see setup_t::out_depth)
 #ifndef NES_BLITTER_OUT_DEPTH
 	#define NES_BLITTER_OUT_DEPTH 16
 #endif
 
-Nes_Blitter::Nes_Blitter() { ntsc = 0; }
+// NES_BLITTER_SIMD: If non-zero, use SSE2 for filter. Defaults to enabled when
+// compiler targets SSE2 and platform-specific optimizations are allowed.
+#ifndef NES_BLITTER_SIMD
+	#if BLARGG_NONPORTABLE && defined (__SSE2__)
+		#define NES_BLITTER_SIMD 1
+	#else
+		#define NES_BLITTER_SIMD 0
+	#endif
+#endif
+
+#if NES_BLITTER_SIMD
+	#include <emmintrin.h>
+#endif
+
+// NES_BLITTER_THREADS: If defined, blit() can split work among several threads
+// using POSIX threads.
+#ifdef NES_BLITTER_THREADS
+	#include <pthread.h>
+#endif
+
+#include "blargg_source.h"
+
+// Entries read past end of table by vectorized filter
+int const table32_padding = 8;
+
+Nes_Blitter::Nes_Blitter()
+{
+	ntsc = 0;
+	table32 = 0;
+	simd_enabled = true;
+	pool = 0;
+	thread_count_ = 1;
+}
 
-Nes_Blitter::~Nes_Blitter() { free( ntsc ); }
+Nes_Blitter::~Nes_Blitter()
+{
+	stop_threads();
+	free( table32 );
+	free( ntsc );
+}
 
 blargg_err_t Nes_Blitter::init()
 {
 	assert( !ntsc );
-	CHECK_ALLOC( ntsc = (nes_ntsc_emph_t*) malloc( sizeof *ntsc ) );
+	CHECK_ALLOC( ntsc = (nes_ntsc_t*) malloc( sizeof *ntsc ) );
+	#if NES_BLITTER_SIMD
+		int const table_size = nes_ntsc_palette_size * nes_ntsc_entry_size;
+		CHECK_ALLOC( table32 = (BOOST::uint32_t*) malloc(
+				(table_size + table32_padding) * sizeof *table32 ) );
+		memset( table32 + table_size, 0, table32_padding * sizeof *table32 );
+	#endif
 	static setup_t const s = { };
 	setup_ = s;
 	setup_.ntsc = nes_ntsc_composite;
+	setup_.out_depth = NES_BLITTER_OUT_DEPTH;
 	return setup( setup_ );
 }
 
 blargg_err_t Nes_Blitter::setup( setup_t const& s )
 {
+	require( s.out_depth == 15 || s.out_depth == 16 || s.out_depth == 32 );
 	setup_ = s;
 	chunk_count = ((Nes_Emu::image_width - setup_.crop.left - setup_.crop.right) + 5) / 6;
 	height = Nes_Emu::image_height - setup_.crop.top - setup_.crop.bottom;
-	nes_ntsc_init_emph( ntsc, &setup_.ntsc );
+	
+	// final chunk can extend past right edge of image
+	last_chunk_size = Nes_Emu::image_width - setup_.crop.left - 1 - (chunk_count - 1) * 6;
+	if ( last_chunk_size > 6 )
+		last_chunk_size = 6;
+		
+	nes_ntsc_init( ntsc, &setup_.ntsc );
+	
+	// nes_ntsc_rgb_t is a long, which might be 64 bits; only the low 32 bits matter
+	if ( table32 )
+	{
+		for ( int n = 0; n < nes_ntsc_palette_size; n++ )
+			for ( int i = 0; i < nes_ntsc_entry_size; i++ )
+				table32 [n * nes_ntsc_entry_size + i] = (BOOST::uint32_t) ntsc->table [n] [i];
+	}
 	return 0;
 }
 
-void Nes_Blitter::blit( Nes_Emu& emu, void* out, long out_pitch )
+void Nes_Blitter::init_job( job_t& j, Nes_Emu const& emu, void* out, long out_pitch ) const
+{
+	j.palette     = emu.frame().palette;
+	j.burst_phase = (setup_.ntsc.merge_fields ? 0 : emu.frame().burst_phase);
+	j.in_pitch    = emu.frame().pitch;
+	j.in          = emu.frame().pixels + setup_.crop.top * j.in_pitch + setup_.crop.left;
+	j.out         = (char*) out;
+	j.out_pitch   = out_pitch;
+}
+
+void Nes_Blitter::blit_rows( Nes_Emu const& emu, void* out, long out_pitch, int first, int count )
+{
+	require( first >= 0 && count >= 0 && first + count <= height );
+	job_t j;
+	init_job( j, emu, out, out_pitch );
+	blit_( j, first, count );
+}
+
+inline void Nes_Blitter::blit_( job_t const& j, int first, int count )
+{
+	if ( count <= 0 )
+		return;
+		
+	#if NES_BLITTER_SIMD
+		if ( simd_enabled )
+		{
+			switch ( setup_.out_depth )
+			{
+				case 15: blit_simd<15>( j, first, count ); return;
+				case 16: blit_simd<16>( j, first, count ); return;
+				case 32: blit_simd<32>( j, first, count ); return;
+			}
+		}
+	#endif
+	
+	switch ( setup_.out_depth )
+	{
+		case 15: blit_scalar<15>( j, first, count ); break;
+		case 16: blit_scalar<16>( j, first, count ); break;
+		case 32: blit_scalar<32>( j, first, count ); break;
+	}
+}
+
+// Reads pixels of final chunk of row, using black for any past the right edge
+inline void Nes_Blitter::read_last_chunk( job_t const& j, unsigned char const* line_in,
+		short* out ) const
+{
+	for ( int i = 0; i < 6; i++ )
+		out [i] = (i < last_chunk_size ? j.palette [line_in [i]] : nes_ntsc_black);
+}
+
+template<int depth>
+void Nes_Blitter::blit_scalar( job_t const& j, int first, int count )
 {
-	short const* palette = emu.frame().palette;
-	int burst_phase = (setup_.ntsc.merge_fields ? 0 : emu.frame().burst_phase);
-	long in_pitch = emu.frame().pitch;
-	unsigned char* in = emu.frame().pixels + setup_.crop.top * in_pitch + setup_.crop.left;
+	short const* palette = j.palette;
+	int burst_phase = (j.burst_phase + first) % nes_ntsc_burst_count;
+	long in_pitch = j.in_pitch;
+	unsigned char const* in = j.in + first * in_pitch;
+	void* out = j.out + first * j.out_pitch;
+	long out_pitch = j.out_pitch;
 	
-	for ( int n = height; n; --n )
+	for ( int n = count; n; --n )
 	{
-		unsigned char* line_in = in;
+		unsigned char const* line_in = in;
 		in += in_pitch;
 		
 		BOOST::uint32_t* line_out = (BOOST::uint32_t*) out;
@@ -49,10 +162,6 @@ void Nes_Blitter::blit( Nes_Emu& emu, void* out, long out_pitch )
 		
 		NES_NTSC_BEGIN_ROW( ntsc, burst_phase,
 				nes_ntsc_black, nes_ntsc_black, palette [*line_in] );
-		
-		line_in [256] = 252; // loop reads 3 extra pixels, so set them to black
-		line_in [257] = 252;
-		line_in [258] = 252;
 		line_in++;
 		
 		burst_phase = (burst_phase + 1) % nes_ntsc_burst_count;
@@ -65,49 +174,361 @@ void Nes_Blitter::blit( Nes_Emu& emu, void* out, long out_pitch )
 		#endif
 		
 		#define OUT_PIXEL( i ) \
-			if ( !(i & 1) ) {\
-				NES_NTSC_RGB_OUT( (i % 7), left, NES_BLITTER_OUT_DEPTH );\
+			if ( depth == 32 ) {\
+				NES_NTSC_RGB_OUT( (i % 7), line_out [i], 32 );\
+			}\
+			else if ( !(i & 1) ) {\
+				NES_NTSC_RGB_OUT( (i % 7), left, depth );\
 				if ( i > 1 ) line_out  [(i/2)-1] = right;\
 			}\
 			else {\
-				NES_NTSC_RGB_OUT( (i % 7), right, NES_BLITTER_OUT_DEPTH );\
+				NES_NTSC_RGB_OUT( (i % 7), right, depth );\
 				COMBINE_PIXELS;\
 			}
 			
-		for ( int n = chunk_count; n; --n )
+		#define FILTER_CHUNK( c0, c1, c2, c3, c4, c5 ) {\
+			unsigned long left, right;\
+			\
+			NES_NTSC_COLOR_IN( 0, c0 );\
+			OUT_PIXEL( 0 );\
+			OUT_PIXEL( 1 );\
+			\
+			NES_NTSC_COLOR_IN( 1, c1 );\
+			OUT_PIXEL( 2 );\
+			OUT_PIXEL( 3 );\
+			\
+			NES_NTSC_COLOR_IN( 2, c2 );\
+			OUT_PIXEL( 4 );\
+			OUT_PIXEL( 5 );\
+			OUT_PIXEL( 6 );\
+			\
+			NES_NTSC_COLOR_IN( 0, c3 );\
+			OUT_PIXEL( 7 );\
+			OUT_PIXEL( 8 );\
+			\
+			NES_NTSC_COLOR_IN( 1, c4 );\
+			OUT_PIXEL( 9 );\
+			OUT_PIXEL( 10);\
+			\
+			NES_NTSC_COLOR_IN( 2, c5 );\
+			OUT_PIXEL( 11 );\
+			OUT_PIXEL( 12 );\
+			OUT_PIXEL( 13 );\
+			\
+			if ( depth != 32 )\
+				line_out [6] = right;\
+			line_out += (depth == 32 ? 14 : 7);\
+		}
+		
+		for ( int n = chunk_count - 1; n; --n )
+		{
+			FILTER_CHUNK( palette [line_in [0]], palette [line_in [1]], palette [line_in [2]],
+					palette [line_in [3]], palette [line_in [4]], palette [line_in [5]] );
+			line_in += 6;
+		}
+		
+		short last [6];
+		read_last_chunk( j, line_in, last );
+		FILTER_CHUNK( last [0], last [1], last [2], last [3], last [4], last [5] );
+		
+		#undef FILTER_CHUNK
+		#undef OUT_PIXEL
+		#undef COMBINE_PIXELS
+	}
+}
+
+#if NES_BLITTER_SIMD
+
+template<int depth>
+void Nes_Blitter::blit_simd( job_t const& j, int first, int count )
+{
+	// Each output pixel is the sum of six kernel entries, from the three most
+	// recent input pixels and the three before them. Seven output pixels are
+	// generated at once, with each kernel contributing a run of seven
+	// consecutive entries (some masked off) to the eight vector lanes. The
+	// eighth lane is junk and gets overwritten by the next seven pixels.
+	
+	typedef BOOST::uint32_t const* kernel_t;
+	int const entry_size = nes_ntsc_entry_size;
+	int const pixel_size = (depth == 32 ? 4 : 2);
+	
+	__m128i const lo2        = _mm_set_epi32( 0, 0, -1, -1 );
+	__m128i const hi_lo2     = _mm_set_epi32( -1, -1, 0, 0 ); // lanes 2-3
+	__m128i const clamp_mask = _mm_set1_epi32( nes_ntsc_clamp_mask );
+	__m128i const clamp_add  = _mm_set1_epi32( nes_ntsc_clamp_add );
+	
+	short const* palette = j.palette;
+	int burst_phase = (j.burst_phase + first) % nes_ntsc_burst_count;
+	unsigned char const* in = j.in + first * j.in_pitch;
+	char* out = j.out + first * j.out_pitch;
+	
+	for ( int n = count; n; --n )
+	{
+		unsigned char const* line_in = in;
+		in += j.in_pitch;
+		char* line_out = out;
+		out += j.out_pitch;
+		
+		kernel_t const ktable = table32 + burst_phase * nes_ntsc_burst_size;
+		burst_phase = (burst_phase + 1) % nes_ntsc_burst_count;
+		
+		short last [6];
+		read_last_chunk( j, line_in + 1 + (chunk_count - 1) * 6, last );
+		
+		// row starts with two black pixels, matching NES_NTSC_BEGIN_ROW
+		kernel_t const black = ktable + nes_ntsc_black * entry_size;
+		kernel_t pa = black;
+		kernel_t pb = black;
+		kernel_t pc = ktable + palette [*line_in++] * entry_size;
+		kernel_t ppb = black;
+		kernel_t ppc = black;
+		
+		for ( int n = chunk_count * 2; n; --n )
 		{
-			unsigned long left, right;
+			kernel_t a, b, c;
+			if ( n > 2 )
+			{
+				a = ktable + palette [line_in [0]] * entry_size;
+				b = ktable + palette [line_in [1]] * entry_size;
+				c = ktable + palette [line_in [2]] * entry_size;
+				line_in += 3;
+			}
+			else
+			{
+				short const* p = &last [(2 - n) * 3];
+				a = ktable + p [0] * entry_size;
+				b = ktable + p [1] * entry_size;
+				c = ktable + p [2] * entry_size;
+			}
 			
-			NES_NTSC_COLOR_IN( 0, palette [line_in [0]] );
-			OUT_PIXEL( 0 );
-			OUT_PIXEL( 1 );
+			#define LOAD( k, i ) _mm_loadu_si128( (__m128i const*) ((k) + (i)) )
 			
-			NES_NTSC_COLOR_IN( 1, palette [line_in [1]] );
-			OUT_PIXEL( 2 );
-			OUT_PIXEL( 3 );
+			// lanes 0-3
+			__m128i raw0 = _mm_add_epi32(
+					_mm_add_epi32( LOAD( a, 0 ), LOAD( pa, 7 ) ),
+					_mm_add_epi32( LOAD( pb, 19 ), LOAD( pc, 31 ) ) );
+			raw0 = _mm_add_epi32( raw0, _mm_add_epi32(
+					_mm_and_si128( LOAD( b, 12 ), hi_lo2 ),
+					_mm_and_si128( LOAD( ppb, 26 ), lo2 ) ) );
+			raw0 = _mm_add_epi32( raw0, LOAD( ppc, 38 ) );
 			
-			NES_NTSC_COLOR_IN( 2, palette [line_in [2]] );
-			OUT_PIXEL( 4 );
-			OUT_PIXEL( 5 );
-			OUT_PIXEL( 6 );
+			// lanes 4-7
+			__m128i raw1 = _mm_add_epi32(
+					_mm_add_epi32( LOAD( a, 4 ), LOAD( pa, 11 ) ),
+					_mm_add_epi32( LOAD( pb, 23 ), LOAD( pc, 35 ) ) );
+			raw1 = _mm_add_epi32( raw1, _mm_add_epi32( LOAD( b, 16 ), LOAD( c, 28 ) ) );
 			
-			NES_NTSC_COLOR_IN( 0, palette [line_in [3]] );
-			OUT_PIXEL( 7 );
-			OUT_PIXEL( 8 );
+			#undef LOAD
 			
-			NES_NTSC_COLOR_IN( 1, palette [line_in [4]] );
-			OUT_PIXEL( 9 );
-			OUT_PIXEL( 10);
+			pa = a;
+			ppb = pb;
+			pb = b;
+			ppc = pc;
+			pc = c;
 			
-			NES_NTSC_COLOR_IN( 2, palette [line_in [5]] );
-			line_in += 6;
-			OUT_PIXEL( 11 );
-			OUT_PIXEL( 12 );
-			OUT_PIXEL( 13 );
+			// NES_NTSC_CLAMP_ and NES_NTSC_RGB_OUT_
+			#define CLAMP_AND_PACK( raw ) {\
+				__m128i sub = _mm_and_si128( _mm_srli_epi32( raw, 9 ), clamp_mask );\
+				__m128i clamp = _mm_sub_epi32( clamp_add, sub );\
+				raw = _mm_or_si128( raw, clamp );\
+				raw = _mm_and_si128( raw, _mm_sub_epi32( clamp, sub ) );\
+				if ( depth == 32 )\
+				{\
+					raw = _mm_or_si128( _mm_or_si128(\
+						_mm_and_si128( _mm_srli_epi32( raw, 5 ), _mm_set1_epi32( 0xFF0000 ) ),\
+						_mm_and_si128( _mm_srli_epi32( raw, 3 ), _mm_set1_epi32( 0x00FF00 ) ) ),\
+						_mm_and_si128( _mm_srli_epi32( raw, 1 ), _mm_set1_epi32( 0x0000FF ) ) );\
+				}\
+				else\
+				{\
+					int const shift = (depth == 16 ? 13 : 14);\
+					raw = _mm_or_si128( _mm_or_si128(\
+						_mm_and_si128( _mm_srli_epi32( raw, shift ),\
+								_mm_set1_epi32( depth == 16 ? 0xF800 : 0x7C00 ) ),\
+						_mm_and_si128( _mm_srli_epi32( raw, shift - 5 ),\
+								_mm_set1_epi32( depth == 16 ? 0x07E0 : 0x03E0 ) ) ),\
+						_mm_and_si128( _mm_srli_epi32( raw, 4 ), _mm_set1_epi32( 0x001F ) ) );\
+					/* sign-extend so pack doesn't saturate */\
+					raw = _mm_srai_epi32( _mm_slli_epi32( raw, 16 ), 16 );\
+				}\
+			}
+			
+			CLAMP_AND_PACK( raw0 );
+			CLAMP_AND_PACK( raw1 );
 			
-			line_out [6] = right;
-			line_out += 7;
+			#undef CLAMP_AND_PACK
+			
+			// don't write past end of row
+			BOOST::uint32_t temp [8];
+			char* dest = (n > 1 ? line_out : (char*) temp);
+			if ( depth == 32 )
+			{
+				_mm_storeu_si128( (__m128i*) dest, raw0 );
+				_mm_storeu_si128( (__m128i*) dest + 1, raw1 );
+			}
+			else
+			{
+				_mm_storeu_si128( (__m128i*) dest, _mm_packs_epi32( raw0, raw1 ) );
+			}
+			if ( n <= 1 )
+				memcpy( line_out, temp, 7 * pixel_size );
+			line_out += 7 * pixel_size;
+		}
+	}
+}
+
+#endif
+
+
+// Threading
+
+#ifdef NES_BLITTER_THREADS
+
+struct Nes_Blitter::thread_pool_t
+{
+	Nes_Blitter* blitter;
+	pthread_mutex_t mutex;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned generation; // incremented for each frame
+	int remain;          // number of workers still busy with current frame
+	bool quit;
+	int count;           // number of worker threads
+	struct worker_t {
+		thread_pool_t* pool;
+		int index;
+		pthread_t thread;
+	} workers [max_threads];
+};
+
+void* Nes_Blitter::thread_func( void* arg )
+{
+	thread_pool_t::worker_t* w = (thread_pool_t::worker_t*) arg;
+	thread_pool_t* pool = w->pool;
+	Nes_Blitter* self = pool->blitter;
+	
+	unsigned generation = 0; // thread might not start until after first frame begins
+	pthread_mutex_lock( &pool->mutex );
+	while ( true )
+	{
+		while ( pool->generation == generation && !pool->quit )
+			pthread_cond_wait( &pool->start, &pool->mutex );
+		if ( pool->quit )
+			break;
+		generation = pool->generation;
+		pthread_mutex_unlock( &pool->mutex );
+		
+		// caller does slice 0
+		int slices = pool->count + 1;
+		int begin = self->height *  w->index      / slices;
+		int end   = self->height * (w->index + 1) / slices;
+		self->blit_( self->job, begin, end - begin );
+		
+		pthread_mutex_lock( &pool->mutex );
+		if ( !--pool->remain )
+			pthread_cond_signal( &pool->done );
+	}
+	pthread_mutex_unlock( &pool->mutex );
+	return 0;
+}
+
+blargg_err_t Nes_Blitter::set_thread_count( int n )
+{
+	require( 1 <= n && n <= max_threads );
+	stop_threads();
+	if ( n > 1 )
+	{
+		CHECK_ALLOC( pool = BLARGG_NEW thread_pool_t );
+		pool->blitter = this;
+		pool->generation = 0;
+		pool->remain = 0;
+		pool->quit = false;
+		pool->count = 0;
+		pthread_mutex_init( &pool->mutex, 0 );
+		pthread_cond_init( &pool->start, 0 );
+		pthread_cond_init( &pool->done, 0 );
+		
+		while ( pool->count < n - 1 )
+		{
+			thread_pool_t::worker_t* w = &pool->workers [pool->count];
+			w->pool = pool;
+			w->index = pool->count + 1;
+			if ( pthread_create( &w->thread, 0, thread_func, w ) )
+			{
+				stop_threads();
+				return "Couldn't create thread";
+			}
+			pool->count++;
 		}
 	}
+	thread_count_ = n;
+	return 0;
+}
+
+void Nes_Blitter::stop_threads()
+{
+	if ( pool )
+	{
+		pthread_mutex_lock( &pool->mutex );
+		pool->quit = true;
+		pthread_cond_broadcast( &pool->start );
+		pthread_mutex_unlock( &pool->mutex );
+		
+		for ( int i = 0; i < pool->count; i++ )
+			pthread_join( pool->workers [i].thread, 0 );
+			
+		pthread_cond_destroy( &pool->done );
+		pthread_cond_destroy( &pool->start );
+		pthread_mutex_destroy( &pool->mutex );
+		delete pool;
+		pool = 0;
+	}
+	thread_count_ = 1;
 }
 
+void Nes_Blitter::blit( Nes_Emu const& emu, void* out, long out_pitch )
+{
+	init_job( job, emu, out, out_pitch );
+	if ( !pool )
+	{
+		blit_( job, 0, height );
+		return;
+	}
+	
+	pthread_mutex_lock( &pool->mutex );
+	pool->generation++;
+	pool->remain = pool->count;
+	pthread_cond_broadcast( &pool->start );
+	pthread_mutex_unlock( &pool->mutex );
+	
+	blit_( job, 0, height / (pool->count + 1) );
+	
+	pthread_mutex_lock( &pool->mutex );
+	while ( pool->remain )
+		pthread_cond_wait( &pool->done, &pool->mutex );
+	pthread_mutex_unlock( &pool->mutex );
+}
+
+#else
+
+struct Nes_Blitter::thread_pool_t { };
+
+void* Nes_Blitter::thread_func( void* ) { return 0; }
+
+blargg_err_t Nes_Blitter::set_thread_count( int n )
+{
+	require( 1 <= n && n <= max_threads );
+	if ( n != 1 )
+		return "Threads not supported";
+	return 0;
+}
+
+void Nes_Blitter::stop_threads() { }
+
+void Nes_Blitter::blit( Nes_Emu const& emu, void* out, long out_pitch )
+{
+	init_job( job, emu, out, out_pitch );
+	blit_( job, 0, height );
+}
+
+#endif
@@ -23,6 +23,9 @@ public:
 			// to internal limitations.
 			int left, top, right, bottom;
 		} crop;
+		
+		// Output pixel format: 15 (RGB555), 16 (RGB565), or 32 (XRGB8888)
+		int out_depth;
 	};
 	setup_t const& setup() const { return setup_; }
 	blargg_err_t setup( setup_t const& );
@@ -31,14 +34,60 @@ public:
 	int out_width() const  { return chunk_count * 14; }
 	int out_height() const { return height; }
 	
-	// Generate NTSC filtered image to 16-bit 565 RGB output pixels
-	void blit( Nes_Emu&, void* out, long pitch );
+	// Generate NTSC filtered image in format specified by setup. Emulator's
+	// graphics buffer is only read.
+	void blit( Nes_Emu const&, void* out, long pitch );
+	
+	// Generate only rows first through first + count - 1 of output image. Out
+	// points to top-left of entire image, as for blit(). Rows don't depend on
+	// each other, so different threads can generate different rows of a frame.
+	void blit_rows( Nes_Emu const&, void* out, long pitch, int first, int count );
+	
+// Performance
+	
+	// Use vectorized filter if it was compiled in (default). Output is identical
+	// either way.
+	void enable_simd( bool b = true ) { simd_enabled = b; }
+	
+	// Have blit() split rows among n threads, including the calling thread.
+	// Only available if compiled with NES_BLITTER_THREADS defined; otherwise
+	// only n = 1 is accepted.
+	enum { max_threads = 8 };
+	blargg_err_t set_thread_count( int n );
+	int thread_count() const { return thread_count_; }
 	
 private:
 	setup_t setup_;
-	nes_ntsc_emph_t* ntsc;
+	nes_ntsc_t* ntsc;
 	int chunk_count;
 	int height;
+	
+	// table with 32-bit entries for vectorized filter
+	BOOST::uint32_t* table32;
+	bool simd_enabled;
+	
+	struct job_t
+	{
+		short const* palette;
+		unsigned char const* in;
+		long in_pitch;
+		int burst_phase;
+		char* out;
+		long out_pitch;
+	};
+	job_t job; // current frame for worker threads
+	void init_job( job_t&, Nes_Emu const&, void* out, long pitch ) const;
+	void blit_( job_t const&, int first, int count );
+	int last_chunk_size;
+	void read_last_chunk( job_t const&, unsigned char const* in, short* out ) const;
+	template<int depth> void blit_scalar( job_t const&, int first, int count );
+	template<int depth> void blit_simd( job_t const&, int first, int count );
+	
+	struct thread_pool_t;
+	thread_pool_t* pool;
+	int thread_count_;
+	void stop_threads();
+	static void* thread_func( void* );
 };
 
 #endif
@@ -104,15 +104,20 @@ long Nes_Buffer::read_samples( blip_sample_t* out, long count )
 		int lin_bass = lin.begin( buf );
 		int nonlin_bass = nonlin.begin( tnd );
 		
-		for ( int n = count; n--; )
+		blip_long lin_block [blip_block_size];
+		blip_long nonlin_block [blip_block_size];
+		for ( long remain = count; remain; )
 		{
-			int s = lin.read() + nonlin.read();
-			lin.next( lin_bass );
-			nonlin.next( nonlin_bass );
-			*out++ = s;
+			int n = blip_block_size;
+			if ( n > remain )
+				n = (int) remain;
+			remain -= n;
 			
-			if ( (BOOST::int16_t) s != s )
-				out [-1] = 0x7FFF - (s >> 24);
+			lin.read_block( lin_block, n, lin_bass );
+			nonlin.read_block( nonlin_block, n, nonlin_bass );
+			blip_mix_block( lin_block, nonlin_block, n );
+			blip_pack_mono( out, lin_block, n );
+			out += n;
 		}
 		
 		lin.end( buf );
@@ -176,6 +181,9 @@ long Nes_Nonlinearizer::make_nonlinear( Blip_Buffer& buf, long count )
 		Blip_Buffer::buf_t_* p = buf.buffer_;
 		long accum = this->accum;
 		long prev = this->prev;
+		// Each entry depends on the running sum of all previous samples, and
+		// there's no vector table lookup before AVX2, so this stays a scalar
+		// loop. A vector prefix sum with scalar lookups measured slower.
 		for ( unsigned n = count; n; --n )
 		{
 			long entry = ENTRY( accum );
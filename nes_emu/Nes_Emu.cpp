@@ -39,14 +39,24 @@ Nes_Emu::Nes_Emu()
 	sound_buf = &silent_buffer;
 	sound_buf_changed_count = 0;
 	equalizer_ = nes_eq;
+	sound_quality_ = Nes_Apu::quality_default;
 	channel_count_ = 0;
 	sound_enabled = false;
 	host_pixels = NULL;
 	single_frame.pixels = 0;
 	single_frame.top = 0;
+	single_frame.unchanged = false;
+	memset( single_frame.changed_rows, ~0, sizeof single_frame.changed_rows );
 	init_called = false;
 	set_palette_range( 0 );
 	memset( single_frame.palette, 0, sizeof single_frame.palette );
+	palette_generation = 0;
+	single_frame.palette_generation = 0;
+	palette_frame = NULL;
+	palette_frame_begin = 0;
+	palette_frame_source = 0;
+	rgb32_generation = ~0ul;
+	rgb16_generation = ~0ul;
 }
 
 Nes_Emu::~Nes_Emu()
@@ -166,6 +176,12 @@ blargg_err_t Nes_Emu::emulate_frame( int joypad1, int joypad2 )
 		f->burst_phase       = emu.ppu.burst_phase;
 		f->pitch             = emu.ppu.host_row_bytes;
 		f->pixels            = emu.ppu.host_pixels + f->left;
+		update_palette_generation( f );
+		
+		if ( emu.ppu.host_pixels )
+			f->unchanged = !emu.ppu.compare_image( f->changed_rows );
+		else
+			invalidate_frame();
 	}
 	else
 	{
@@ -176,6 +192,59 @@ blargg_err_t Nes_Emu::emulate_frame( int joypad1, int joypad2 )
 	return 0;
 }
 
+void Nes_Emu::update_palette_generation( frame_t* f )
+{
+	// Host palette is only certain to be unchanged if it was captured once, from
+	// the same PPU palette as the previous frame's
+	bool single = (f->palette_size == Nes_Ppu::palette_increment);
+	if ( !single || f != palette_frame || f->palette_begin != palette_frame_begin ||
+			emu.ppu.captured_generation != palette_frame_source )
+		f->palette_generation = ++palette_generation;
+	
+	palette_frame        = (single ? f : NULL);
+	palette_frame_begin  = f->palette_begin;
+	palette_frame_source = emu.ppu.captured_generation;
+}
+
+BOOST::uint32_t const* Nes_Emu::rgb32_palette()
+{
+	if ( rgb32_generation != frame_->palette_generation )
+	{
+		rgb32_generation = frame_->palette_generation;
+		for ( int i = 0; i < max_palette_size; i++ )
+		{
+			rgb_t const& c = nes_colors [frame_->palette [i] & (color_table_size - 1)];
+			rgb32_palette_ [i] = (BOOST::uint32_t) c.red << 16 | c.green << 8 | c.blue;
+		}
+	}
+	return rgb32_palette_;
+}
+
+BOOST::uint16_t const* Nes_Emu::rgb16_palette()
+{
+	if ( rgb16_generation != frame_->palette_generation )
+	{
+		rgb16_generation = frame_->palette_generation;
+		for ( int i = 0; i < max_palette_size; i++ )
+		{
+			rgb_t const& c = nes_colors [frame_->palette [i] & (color_table_size - 1)];
+			rgb16_palette_ [i] = (c.red >> 3) << 11 | (c.green >> 2) << 5 | c.blue >> 3;
+		}
+	}
+	return rgb16_palette_;
+}
+
+void Nes_Emu::invalidate_frame()
+{
+	// report all scanlines of current frame and next one as changed
+	emu.ppu.invalidate_image();
+	if ( frame_ )
+	{
+		frame_->unchanged = false;
+		memset( frame_->changed_rows, ~0, sizeof frame_->changed_rows );
+	}
+}
+
 // Extras
 
 blargg_err_t Nes_Emu::load_ines( Auto_File_Reader in )
@@ -261,12 +330,12 @@ void Nes_Emu::set_frame_rate( double rate )
 	sound_buf->clock_rate( (long) (1789773 / 60.0 * rate) );
 }
 
-blargg_err_t Nes_Emu::set_sample_rate( long rate, Multi_Buffer* new_buf )
+blargg_err_t Nes_Emu::set_sample_rate( long rate, Multi_Buffer* new_buf, int msec )
 {
 	require( new_buf );
 	RETURN_ERR( auto_init() );
 	emu.impl->apu.volume( 1.0 ); // cancel any previous non-linearity
-	RETURN_ERR( new_buf->set_sample_rate( rate, 1200 / frame_rate ) );
+	RETURN_ERR( new_buf->set_sample_rate( rate, max( msec, 1200 / frame_rate ) ) );
 	sound_buf = new_buf;
 	sound_buf_changed_count = 0;
 	if ( new_buf != default_sound_buf )
@@ -285,6 +354,14 @@ blargg_err_t Nes_Emu::set_sample_rate( long rate )
 	return set_sample_rate( rate, default_sound_buf );
 }
 
+blargg_err_t Nes_Emu::set_sound_quality( Nes_Apu::quality_t q )
+{
+	RETURN_ERR( auto_init() );
+	RETURN_ERR( emu.impl->apu.set_quality( q ) );
+	sound_quality_ = q;
+	return 0;
+}
+
 void Nes_Emu::set_equalizer( equalizer_t const& eq )
 {
 	equalizer_ = eq;
@@ -321,10 +398,13 @@ void Nes_Emu::enable_sound( bool enabled )
 
 void Nes_Emu::fade_samples( blip_sample_t* p, int size, int step )
 {
-	if ( size >= sound_fade_size )
+	// stereo pairs share the same volume
+	int const chan_count = sound_buf->samples_per_frame();
+	int const fade_size = sound_fade_size * chan_count;
+	if ( size >= fade_size )
 	{
 		if ( step < 0 )
-			p += size - sound_fade_size;
+			p += size - fade_size;
 		
 		int const shift = 15;
 		int mul = (1 - step) << (shift - 1);
@@ -332,8 +412,11 @@ void Nes_Emu::fade_samples( blip_sample_t* p, int size, int step )
 		
 		for ( int n = sound_fade_size; n--; )
 		{
-			*p = (*p * mul) >> 15;
-			++p;
+			for ( int c = chan_count; c--; )
+			{
+				*p = (*p * mul) >> 15;
+				++p;
+			}
 			mul += step;
 		}
 	}
@@ -358,6 +441,19 @@ long Nes_Emu::read_samples( short* out, long out_size )
 	return count;
 }
 
+long Nes_Emu::read_stereo_samples( short* out, long max_pairs )
+{
+	require( sound_buf->samples_per_frame() <= 2 ); // can't mix down Stem_Buffer
+	if ( sound_buf->samples_per_frame() == 2 )
+		return read_samples( out, max_pairs * 2 ) / 2;
+	
+	// expand from end so that unread mono samples are never overwritten
+	long count = read_samples( out, max_pairs );
+	for ( long i = count; i--; )
+		out [i * 2 + 1] = out [i * 2] = out [i];
+	return count;
+}
+
 Nes_Emu::rgb_t const Nes_Emu::nes_colors [color_table_size] =
 {
 	// generated with nes_ntsc default settings
@@ -32,8 +32,7 @@ public:
 	
 	// Size and depth of graphics buffer required for rendering. Note that this
 	// is larger than the actual image, with a temporary area around the edge
-	// that gets filled with junk. Its height is many times larger in Nes_Recorder
-	// to allow caching of multiple images.
+	// that gets filled with junk.
 	enum { buffer_width  = Nes_Ppu::buffer_width };
 	int buffer_height() const { return buffer_height_; }
 	enum { bits_per_pixel = 8 };
@@ -72,13 +71,34 @@ public:
 		int palette_begin;      // first host palette entry, as set by set_palette_range()
 		int palette_size;       // number of entries used for current frame
 		short palette [max_palette_size]; // [palette_begin to palette_begin+palette_size-1]
+		
+		// Changes whenever palette entries used by frame change. Values are never
+		// reused, even among different frame_t objects, so this can be used as a key
+		// for cached conversions of the palette.
+		unsigned long palette_generation;
+		
+		// Scanlines of image that differ from the last frame rendered with graphics.
+		// Bit (y & 31) of changed_rows [y >> 5] is set if scanline y changed. All are
+		// set if palette changed or previous image isn't available.
+		enum { changed_rows_size = (image_height + 31) / 32 };
+		BOOST::uint32_t changed_rows [changed_rows_size];
+		bool unchanged;         // true if image is identical to last frame rendered
 	};
 	frame_t const& frame() const { return *frame_; }
 	
 	// Read samples for the current frame. Returns number of samples read into buffer.
-	// Currently all samples must be read in one call.
+	// Currently all samples must be read in one call. To play them from another
+	// thread, write them to a Sample_Ring.
 	virtual long read_samples( short* out, long max_samples );
 	
+	// Read samples for the current frame as interleaved left/right pairs. With a
+	// stereo sound buffer (Stereo_Buffer, Effects_Buffer) these are rendered
+	// directly, otherwise mono samples are expanded in place. Not supported for
+	// sound buffers with more than two channels per frame, such as Stem_Buffer.
+	// Returns number of pairs read into buffer, which must have room for
+	// 2 * max_pairs samples.
+	long read_stereo_samples( short* out, long max_pairs );
+	
 // Additional features
 	
 	// Use already-loaded cartridge. Retains pointer, so it must be kept around until
@@ -106,8 +126,10 @@ public:
 // Sound
 	
 	// Set sample rate and use a custom sound buffer instead of the default
-	// mono buffer, i.e. Nes_Buffer, Effects_Buffer, etc..
-	blargg_err_t set_sample_rate( long rate, Multi_Buffer* );
+	// mono buffer, i.e. Nes_Buffer, Effects_Buffer, etc.. Buffer length is in
+	// milliseconds; it's never less than a little over one frame, which is also
+	// the default and gives lowest latency and memory use.
+	blargg_err_t set_sample_rate( long rate, Multi_Buffer*, int msec = 0 );
 	
 	// Adjust effective frame rate by changing how many samples are generated each frame.
 	// Allows fine tuning of frame rate to improve synchronization.
@@ -116,6 +138,13 @@ public:
 	// Number of sound channels for current cartridge
 	int channel_count() const { return channel_count_; }
 	
+	// Set synthesis quality of the built-in sound channels (see Nes_Apu.h). Lower
+	// quality takes less CPU time. Expansion sound chips are unaffected.
+	blargg_err_t set_sound_quality( Nes_Apu::quality_t );
+	
+	// Current synthesis quality
+	Nes_Apu::quality_t sound_quality() const { return sound_quality_; }
+	
 	// Frequency equalizer parameters
 	struct equalizer_t {
 		double treble; // 5.0 = extra-crisp, -200.0 = muffled
@@ -165,6 +194,12 @@ public:
 	struct rgb_t { unsigned char red, green, blue; };
 	static rgb_t const nes_colors [color_table_size];
 	
+	// Lookup tables mapping graphics buffer pixels of current frame directly to
+	// nes_colors in XRGB8888 or RGB565 format. Only rebuilt when
+	// frame().palette_generation changes.
+	BOOST::uint32_t const* rgb32_palette();
+	BOOST::uint16_t const* rgb16_palette();
+	
 	// Hide/show/enhance sprites. Sprite mode does not affect emulation accuracy.
 	enum sprite_mode_t {
 		sprites_hidden = 0,
@@ -213,6 +248,7 @@ private:
 	virtual blargg_err_t init_();
 	
 	virtual void loading_state( Nes_State const& ) { }
+	void invalidate_frame();
 	void load_state( Nes_State_ const& );
 	void save_state( Nes_State_* s ) const { emu.save_state( s ); }
 	int joypad_read_count() const { return emu.joypad_read_count; }
@@ -230,6 +266,7 @@ private:
 	unsigned sound_buf_changed_count;
 	Silent_Buffer silent_buffer;
 	equalizer_t equalizer_;
+	Nes_Apu::quality_t sound_quality_;
 	int channel_count_;
 	bool sound_enabled;
 	void enable_sound( bool );
@@ -239,6 +276,17 @@ private:
 	char* host_pixels;
 	int host_palette_size;
 	frame_t single_frame;
+	
+	// palette change tracking
+	unsigned long palette_generation;   // last value given to frame_t::palette_generation
+	frame_t const* palette_frame;       // NULL if last frame's palette wasn't captured once
+	int palette_frame_begin;
+	unsigned long palette_frame_source; // Nes_Ppu::captured_generation for last frame
+	void update_palette_generation( frame_t* );
+	BOOST::uint32_t rgb32_palette_ [max_palette_size];
+	BOOST::uint16_t rgb16_palette_ [max_palette_size];
+	unsigned long rgb32_generation;
+	unsigned long rgb16_generation;
 	Nes_Cart private_cart;
 	Nes_Core emu; // large; keep at end
 	
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
 Nes_File_Writer::Nes_File_Writer()
 {
+	tell_ = 0;
 	write_remain = 0;
 	depth_ = 0;
 }
@@ -50,6 +51,7 @@ blargg_err_t Nes_File_Writer::write_header( nes_tag_t tag, long size )
 	h.tag = tag;
 	h.size = size;
 	h.swap();
+	tell_ += sizeof h;
 	return out->write( &h, sizeof h );
 }
 
@@ -70,6 +72,7 @@ Nes_File_Writer::error_t Nes_File_Writer::write( void const* p, long s )
 {
 	write_remain -= s;
 	require( write_remain >= 0 );
+	tell_ += s;
 	return out->write( p, s );
 }
 
@@ -79,6 +82,11 @@ blargg_err_t Nes_File_Writer::end()
 	return end_group();
 }
 
+Nes_File_Writer::error_t Nes_File_Writer::flush()
+{
+	return out->flush();
+}
+
 blargg_err_t Nes_File_Writer::end_group()
 {
 	require( depth_ > 0 );
@@ -210,8 +218,7 @@ blargg_err_t Nes_File_Reader::skip_v( int s )
 	require( block_type() == data_block );
 	if ( (unsigned long) s > h.size )
 		return "Tried to skip past end of data";
-	h.size -= s;
-	set_remain( h.size );
+	h.size -= s; // Data_Reader::skip() updates remain()
 	return in->skip( s );
 }
 
@@ -220,7 +227,6 @@ blargg_err_t Nes_File_Reader::read_v( void* p, int n )
 	require( block_type() == data_block );
 	if ( (unsigned long) n > h.size )
 		n = h.size;
-	h.size -= n;
-	set_remain( h.size );
+	h.size -= n; // Data_Reader::read() updates remain()
 	return in->read( p, n );
 }
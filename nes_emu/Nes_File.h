@@ -37,8 +37,16 @@ public:
 	// End file
 	blargg_err_t end();
 	
+	// Pass everything written so far on to file, so it survives if program
+	// is later stopped before file is ended
+	error_t flush();
+	
+	// Number of bytes written to file so far
+	long tell() const { return tell_; }
+	
 private:
 	Auto_File_Writer out;
+	long tell_;
 	long write_remain;
 	int depth_;
 	blargg_err_t write_header( nes_tag_t tag, long size );
@@ -5,6 +5,8 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include "blargg_endian.h"
+#include "Nes_Mapped_File.h"
 
 /* Copyright (C) 2004-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -21,9 +23,63 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
 nes_tag_t const joypad_data_tag = FOUR_CHAR('JOYP');
 
-Nes_Film::Nes_Film() { clear( 60 * 60 ); }
+// Index at end of movie file, so it can be opened without reading all of it:
+// copy of movie_info_t, file offsets of first and second joypad's data (zero if
+// absent), snapshot count, then time, offset and size of each snapshot group in
+// time order, and finally size of index data so it can be found from end of file.
+// Values other than the movie_info_t are 32-bit little-endian.
+nes_tag_t const movie_index_tag = FOUR_CHAR('INDX');
 
-Nes_Film::~Nes_Film() { }
+// Stream file is a group of segment blocks, each holding a small movie file
+// followed by a 32-bit little-endian checksum of it. A segment that begins a new
+// recording is a normal movie file, otherwise its group tag is the segment tag and
+// its frames continue the recording from segment's beginning. Recording is
+// started over at that point if it was already past it.
+nes_tag_t const movie_stream_tag = FOUR_CHAR('NMST');
+nes_tag_t const stream_segment_tag = FOUR_CHAR('SEGM');
+
+// Written by write_inputs() in place of snapshots: time and hash of each, as
+// 32-bit little-endian values in time order
+nes_tag_t const snapshot_hash_tag = FOUR_CHAR('HASH');
+
+struct Nes_Film::map_t
+{
+	Nes_Mapped_File file;
+	frame_count_t begin;        // time of first joypad entry in file
+	frame_count_t end;          // later snapshots and joypad data in file are stale
+	long joypad [2];            // offsets of joypad data, or 0 if absent
+	int count;                  // number of snapshots
+	BOOST::uint32_t* entries;   // time, offset and size of each snapshot
+	
+	map_t() { entries = 0; }
+	~map_t() { free( entries ); }
+};
+
+struct Nes_Film::stream_t
+{
+	Nes_File_Writer out;
+	frame_count_t time;     // beginning of frames not yet written
+	frame_count_t window;   // number of frames to keep in film, or 0 for all
+	bool restart;           // next segment begins new recording
+};
+
+Nes_Film::Nes_Film()
+{
+	map_ = 0;
+	stream_ = 0;
+	hashes = 0;
+	node = 0;
+	clear( 60 * 60 );
+}
+
+Nes_Film::~Nes_Film()
+{
+	if ( stream_ )
+		end_stream();
+	delete map_;
+	free( hashes );
+	release( node );
+}
 
 void Nes_Film::clear( frame_count_t new_period )
 {
@@ -33,6 +89,13 @@ void Nes_Film::clear( frame_count_t new_period )
 	has_joypad_sync_ = true;
 	has_second_joypad = false;
 	data.clear( new_period );
+	delete map_;
+	map_ = 0;
+	free( hashes );
+	hashes = 0;
+	hash_count = 0;
+	release( node );
+	node = 0;
 }
 
 inline int Nes_Film::calc_block_count( frame_count_t new_end ) const
@@ -71,6 +134,8 @@ Nes_Film::joypad_t Nes_Film::get_joypad( frame_count_t time ) const
 
 blargg_err_t Nes_Film::set_joypad( frame_count_t time, joypad_t joypad )
 {
+	diverge( time );
+	
 	int index;
 	int block = calc_block( time, &index );
 	block_t* b = data.write( block );
@@ -93,6 +158,9 @@ blargg_err_t Nes_Film::record_frame( frame_count_t time, joypad_t joypad, Nes_St
 	if ( out )
 		*out = 0;
 	
+	if ( stream_ )
+		RETURN_ERR( stream_frames( time ) );
+	
 	if ( !contains( time ) )
 	{
 		require( blank() );
@@ -101,6 +169,15 @@ blargg_err_t Nes_Film::record_frame( frame_count_t time, joypad_t joypad, Nes_St
 		time_offset = time - time % period_;
 	}
 	
+	if ( map_ && time < map_->end )
+		map_->end = time; // rest of file is being recorded over
+	
+	diverge( time );
+	
+	// hashes of later snapshots are for what's being recorded over
+	while ( hash_count && get_le32( &hashes [hash_count * 8 - 8] ) > (unsigned long) time )
+		hash_count--;
+	
 	RETURN_ERR( resize( time + 1 ) );
 	
 	RETURN_ERR( set_joypad( time, joypad ) );
@@ -172,12 +249,188 @@ void Nes_Film::trim( frame_count_t first, frame_count_t last )
 	}
 	
 	if ( begin_ <= last && last < end_ )
+	{
+		diverge( last );
 		end_ = last;
+	}
 	data.trim( first_block, calc_block_count( end_ ) );
 	// be sure snapshot for beginning was preserved
 	assert( nearest_snapshot( begin_ ) );
 }
 
+// Branches
+
+// A node's recording is the same as its parent's before 'time'. Its references
+// include its children, so a node with more than one is shared.
+struct Nes_Film::node_t
+{
+	node_t* parent;
+	frame_count_t time;
+	int depth;
+	int refs;
+};
+
+void Nes_Film::release( node_t* n )
+{
+	while ( n && !--n->refs )
+	{
+		node_t* parent = n->parent;
+		delete n;
+		n = parent;
+	}
+}
+
+// Note that recording is changing at time, so it no longer matches branches after it
+void Nes_Film::diverge( frame_count_t time )
+{
+	if ( node && node->refs > 1 )
+	{
+		// continue on new child, which takes over film's reference to node
+		node_t* n = BLARGG_NEW node_t;
+		if ( n )
+		{
+			n->parent = node;
+			n->time = time;
+			n->depth = node->depth + 1;
+			n->refs = 1;
+		}
+		else
+		{
+			release( node ); // film is simply no longer related to its branches
+		}
+		node = n;
+	}
+	else if ( node && time < node->time )
+	{
+		node->time = time;
+	}
+}
+
+frame_count_t Nes_Film::same_until( Nes_Film_Branch const& b ) const
+{
+	frame_count_t time = min( end_, b.end_ );
+	node_t const* x = node;
+	node_t const* y = b.node;
+	while ( x != y )
+	{
+		if ( !x || !y )
+			return -invalid_frame_count;
+		
+		// step up from deeper node towards common ancestor
+		node_t const*& deeper = (x->depth >= y->depth ? x : y);
+		if ( time > deeper->time )
+			time = deeper->time;
+		deeper = deeper->parent;
+	}
+	if ( !x )
+		return -invalid_frame_count;
+	return time;
+}
+
+static blargg_err_t copy_hashes( byte const* in, int count, byte** out )
+{
+	*out = 0;
+	if ( count )
+	{
+		CHECK_ALLOC( *out = (byte*) malloc( count * 8 ) );
+		memcpy( *out, in, count * 8 );
+	}
+	return 0;
+}
+
+blargg_err_t Nes_Film::save_branch( Nes_Film_Branch* out ) const
+{
+	require( !map_ ); // parts not read from file yet would be missing
+	
+	if ( !node )
+	{
+		CHECK_ALLOC( node = BLARGG_NEW node_t );
+		node->parent = 0;
+		node->time = invalid_frame_count;
+		node->depth = 0;
+		node->refs = 1;
+	}
+	
+	byte* new_hashes;
+	RETURN_ERR( copy_hashes( hashes, hash_count, &new_hashes ) );
+	blargg_err_t err = data.save( &out->data );
+	if ( err )
+	{
+		free( new_hashes );
+		return err;
+	}
+	
+	Nes_Film_Branch& b = *out;
+	free( b.hashes );
+	b.hashes = new_hashes;
+	b.hash_count = hash_count;
+	release( b.node );
+	b.node = node;
+	node->refs++;
+	b.begin_ = begin_;
+	b.end_ = end_;
+	b.period_ = period_;
+	b.time_offset = time_offset;
+	b.has_joypad_sync_ = has_joypad_sync_;
+	b.has_second_joypad = has_second_joypad;
+	return 0;
+}
+
+blargg_err_t Nes_Film::load_branch( Nes_Film_Branch const& b )
+{
+	require( !stream_ );
+	
+	byte* new_hashes;
+	RETURN_ERR( copy_hashes( b.hashes, b.hash_count, &new_hashes ) );
+	
+	// data's buffers are kept if period is the same
+	if ( period_ != b.period_ )
+		clear( b.period_ );
+	delete map_;
+	map_ = 0;
+	blargg_err_t err = data.restore( b.data );
+	if ( err )
+	{
+		free( new_hashes );
+		clear();
+		return err;
+	}
+	
+	free( hashes );
+	hashes = new_hashes;
+	hash_count = b.hash_count;
+	if ( b.node )
+		b.node->refs++;
+	release( node );
+	node = b.node;
+	begin_ = b.begin_;
+	end_ = b.end_;
+	time_offset = b.time_offset;
+	has_joypad_sync_ = b.has_joypad_sync_;
+	has_second_joypad = b.has_second_joypad;
+	return 0;
+}
+
+Nes_Film_Branch::Nes_Film_Branch()
+{
+	node = 0;
+	hashes = 0;
+	hash_count = 0;
+	period_ = 0;
+	begin_ = end_ = -invalid_frame_count;
+}
+
+void Nes_Film_Branch::clear()
+{
+	data.clear();
+	Nes_Film::release( node );
+	node = 0;
+	free( hashes );
+	hashes = 0;
+	hash_count = 0;
+	begin_ = end_ = -invalid_frame_count;
+}
+
 // Nes_Film_Joypad_Scanner
 
 // Simplifies scanning joypad data
@@ -246,12 +499,125 @@ bool Nes_Film_Joypad_Scanner::next()
 	return true;
 }
 
+// Nes_Film_Index
+
+// Collects snapshot offsets while film is written
+class Nes_Film_Index {
+public:
+	Nes_Film_Index( movie_info_t const& );
+	~Nes_Film_Index();
+	
+	blargg_err_t init( int max_count );
+	void add( frame_count_t, long offset, long size );
+	blargg_err_t write( Nes_File_Writer& );
+	
+	long joypad [2];
+private:
+	movie_info_t info;
+	byte* buf;
+	int count;
+	int max_count;
+};
+
+Nes_Film_Index::Nes_Film_Index( movie_info_t const& i ) : info( i )
+{
+	joypad [0] = 0;
+	joypad [1] = 0;
+	buf = 0;
+	count = 0;
+	max_count = 0;
+}
+
+Nes_Film_Index::~Nes_Film_Index() { free( buf ); }
+
+blargg_err_t Nes_Film_Index::init( int n )
+{
+	CHECK_ALLOC( buf = (byte*) malloc( (3 + n * 3 + 1) * 4 ) );
+	max_count = n;
+	return 0;
+}
+
+void Nes_Film_Index::add( frame_count_t time, long offset, long size )
+{
+	require( count < max_count );
+	byte* p = &buf [(3 + count++ * 3) * 4];
+	set_le32( p + 0, time );
+	set_le32( p + 4, offset );
+	set_le32( p + 8, size );
+}
+
+blargg_err_t Nes_Film_Index::write( Nes_File_Writer& out )
+{
+	long size = (3 + count * 3 + 1) * 4;
+	set_le32( &buf [0], joypad [0] );
+	set_le32( &buf [4], joypad [1] );
+	set_le32( &buf [8], count );
+	set_le32( &buf [size - 4], sizeof info + size );
+	
+	info.swap();
+	RETURN_ERR( out.write_block_header( movie_index_tag, sizeof info + size ) );
+	RETURN_ERR( out.write( &info, sizeof info ) );
+	return out.write( buf, size );
+}
+
+static BOOST::uint32_t adler32( byte const* p, long n )
+{
+	unsigned long a = 1;
+	unsigned long b = 0;
+	while ( n > 0 )
+	{
+		long count = (n < 5552 ? n : 5552); // keeps sums from overflowing
+		n -= count;
+		do
+		{
+			a += *p++;
+			b += a;
+		}
+		while ( --count );
+		a %= 65521;
+		b %= 65521;
+	}
+	return b << 16 | a;
+}
+
+// Hash of snapshot as it's written to file, without sound state. Sound isn't
+// emulated exactly when it's not being output, as when replaying, so it can
+// differ from a recording even though the game's state doesn't. Mapper state is
+// left out entirely if with_mapper is false or where its sound state starts isn't
+// known, as for snapshots read from a file.
+static blargg_err_t hash_snapshot( Nes_State_ const& ss, BOOST::uint32_t* out,
+		bool with_mapper = true )
+{
+	Nes_State_ game = ss;
+	game.apu_valid = false;
+	mapper_state_t mapper;
+	if ( ss.mapper_valid && with_mapper && ss.mapper->sound_offset >= 0 )
+	{
+		mapper.size = ss.mapper->sound_offset;
+		mapper.sound_offset = mapper.size;
+		memcpy( mapper.data, ss.mapper->data, mapper.size );
+		game.mapper = &mapper;
+	}
+	else
+	{
+		game.mapper_valid = false;
+	}
+	
+	Mem_Writer mem;
+	Nes_File_Writer writer;
+	RETURN_ERR( writer.begin( mem, state_file_tag ) );
+	RETURN_ERR( game.write_blocks( writer ) );
+	RETURN_ERR( writer.end() );
+	*out = adler32( (byte const*) mem.data(), mem.size() );
+	return 0;
+}
+
 // Nes_Film_Writer
 
 blargg_err_t Nes_Film_Writer::end( Nes_Film const& film, frame_count_t first,
 		frame_count_t last, frame_count_t period )
 {
-	RETURN_ERR( film.write_blocks( *this, first, last, period ) );
+	RETURN_ERR( film.write_blocks( *this, first, last, period, false ) );
 	return Nes_File_Writer::end();
 }
 
@@ -263,15 +629,46 @@ blargg_err_t Nes_Film::write( Auto_File_Writer out, frame_count_t first,
 	return writer.end( *this, first, last, (period ? period : this->period()) );
 }
 
-static blargg_err_t write_state( Nes_State_ const& ss, Nes_File_Writer& out )
+blargg_err_t Nes_Film::write_inputs( Auto_File_Writer out, frame_count_t period ) const
 {
+	Nes_File_Writer writer;
+	RETURN_ERR( writer.begin( out, movie_file_tag ) );
+	RETURN_ERR( write_blocks( writer, begin(), end(), (period ? period : this->period()), true ) );
+	return writer.end();
+}
+
+// Index can be NULL
+static blargg_err_t write_state( Nes_State_ const& ss, Nes_File_Writer& out,
+		Nes_Film_Index* index )
+{
+	long offset = out.tell();
 	RETURN_ERR( out.begin_group( state_file_tag ) );
 	RETURN_ERR( ss.write_blocks( out ) );
-	return out.end_group();
+	RETURN_ERR( out.end_group() );
+	if ( index )
+		index->add( ss.timestamp(), offset, out.tell() - offset );
+	return 0;
+}
+
+blargg_err_t Nes_Film::write_joypad( Nes_File_Writer& out, int index, frame_count_t first,
+		frame_count_t last ) const
+{
+	Nes_Film_Joypad_Scanner joypad( first, last, *this );
+	RETURN_ERR( out.write_block_header( joypad_data_tag, joypad.remain ) );
+	do
+	{
+		block_t const& b = data.read( joypad.block );
+		byte const* data = b.joypads [index];
+		if ( !data )
+			CHECK_ALLOC( data = joypad.buf() );
+		RETURN_ERR( out.write( &data [joypad.offset], joypad.count ) );
+	}
+	while ( joypad.next() );
+	return 0;
 }
 
 blargg_err_t Nes_Film::write_blocks( Nes_File_Writer& out, frame_count_t first,
-		frame_count_t last, frame_count_t period ) const
+		frame_count_t last, frame_count_t period, bool hash_only ) const
 {
 	require( contains_range( first, last ) );
 	require( nearest_snapshot( first ) );
@@ -305,26 +702,23 @@ blargg_err_t Nes_Film::write_blocks( Nes_File_Writer& out, frame_count_t first,
 	}
 	RETURN_ERR( write_nes_state( out, info ) );
 	
+	// file with only first snapshot is small enough to read entirely, so has no index
+	Nes_Film_Index film_index( info );
+	if ( !hash_only )
+		RETURN_ERR( film_index.init( snapshot_index( last ) - snapshot_index( first_snapshot ) + 1 ) );
+	Mem_Writer hash_data;
+	
 	// write joypad data
 	for ( int i = 0; i < info.joypad_count; i++ )
 	{
-		Nes_Film_Joypad_Scanner joypad( first_snapshot, last, *this );
-		RETURN_ERR( out.write_block_header( joypad_data_tag, joypad.remain ) );
-		do
-		{
-			block_t const& b = data.read( joypad.block );
-			byte const* data = b.joypads [i];
-			if ( !data )
-				CHECK_ALLOC( data = joypad.buf() );
-			RETURN_ERR( out.write( &data [joypad.offset], joypad.count ) );
-		}
-		while ( joypad.next() );
+		film_index.joypad [i] = out.tell() + sizeof (nes_block_t);
+		RETURN_ERR( write_joypad( out, i, first_snapshot, last ) );
 	}
 	
 	// write first state
 	int index = snapshot_index( first_snapshot );
 	assert( snapshots( index ).timestamp() == first_snapshot );
-	RETURN_ERR( write_state( snapshots( index ), out ) );
+	RETURN_ERR( write_state( snapshots( index ), out, (hash_only ? 0 : &film_index) ) );
 	
 	// write snapshots that fall within output periods
 	// TODO: thorougly verify this tricky algorithm
@@ -344,12 +738,32 @@ blargg_err_t Nes_Film::write_blocks( Nes_File_Writer& out, frame_count_t first,
 			{
 				time += period;
 				//dprintf( "time: %6d\n", t );
-				RETURN_ERR( write_state( ss, out ) );
+				if ( !hash_only )
+				{
+					RETURN_ERR( write_state( ss, out, &film_index ) );
+				}
+				else
+				{
+					BOOST::uint32_t hash;
+					RETURN_ERR( hash_snapshot( ss, &hash ) );
+					byte entry [8];
+					set_le32( entry + 0, t );
+					set_le32( entry + 4, hash );
+					RETURN_ERR( hash_data.write( entry, sizeof entry ) );
+				}
 			}
 		}
 	}
 	
-	return 0;
+	if ( hash_only )
+	{
+		if ( !hash_data.size() )
+			return 0;
+		RETURN_ERR( out.write_block_header( snapshot_hash_tag, hash_data.size() ) );
+		return out.write( hash_data.data(), hash_data.size() );
+	}
+	
+	return film_index.write( out );
 }
 
 // Nes_Film_Reader
@@ -434,6 +848,14 @@ blargg_err_t Nes_Film_Reader::next_block_()
 			RETURN_ERR( film->read_snapshot( *this ) );
 			break;
 		
+		case movie_index_tag:
+			break; // only used by Nes_Film::open()
+		
+		case snapshot_hash_tag:
+			RETURN_ERR( customize() );
+			RETURN_ERR( film->read_hashes( *this ) );
+			break;
+		
 		default:
 			if ( done() )
 			{
@@ -529,3 +951,457 @@ blargg_err_t Nes_Film::read_snapshot( Nes_File_Reader& in )
 	return in.exit_group();
 }
 
+blargg_err_t Nes_Film::read_hashes( Nes_File_Reader& in )
+{
+	long size = in.remain();
+	if ( size % 8 )
+		return "Corrupt movie file";
+	
+	void* p = realloc( hashes, size );
+	CHECK_ALLOC( p || !size );
+	hashes = (byte*) p;
+	hash_count = size / 8;
+	return in.read( hashes, size );
+}
+
+blargg_err_t Nes_Film::verify_snapshot( Nes_State_ const& ss ) const
+{
+	// binary search for hash with snapshot's time
+	unsigned long const time = ss.timestamp();
+	int lo = 0;
+	int hi = hash_count;
+	while ( lo < hi )
+	{
+		int mid = (lo + hi) / 2;
+		unsigned long t = get_le32( &hashes [mid * 8] );
+		if ( t == time )
+		{
+			BOOST::uint32_t const expected = get_le32( &hashes [mid * 8 + 4] );
+			BOOST::uint32_t hash;
+			RETURN_ERR( hash_snapshot( ss, &hash ) );
+			if ( hash != expected )
+			{
+				// hash was written without mapper state if snapshot was read from file
+				RETURN_ERR( hash_snapshot( ss, &hash, false ) );
+				if ( hash != expected )
+					return "Replay doesn't match movie";
+			}
+			break;
+		}
+		if ( t < time )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0;
+}
+
+
+// Opening indexed file
+
+// Read snapshot taken at time from state group that has been entered
+static blargg_err_t read_state( Nes_File_Reader& in, frame_count_t time, Nes_State_& ss )
+{
+	nes_state_t info;
+	memset( &info, 0, sizeof info );
+	RETURN_ERR( in.next_block() );
+	if ( in.block_tag() != info.tag )
+		return "Corrupt movie file";
+	RETURN_ERR( read_nes_state( in, &info ) );
+	if ( (frame_count_t) info.frame_count != time )
+		return "Corrupt movie file";
+	
+	ss.clear();
+	ss.set_nes_state( info );
+	do
+	{
+		RETURN_ERR( ss.read_blocks( in ) );
+	}
+	while ( in.block_type() != in.group_end );
+	return 0;
+}
+
+static blargg_err_t read_mapped_state( Nes_Mapped_File& file, BOOST::uint32_t const* entry,
+		Nes_State_& ss )
+{
+	byte const* p;
+	RETURN_ERR( file.data( entry [1], entry [2], &p ) );
+	Mem_File_Reader mem( p, entry [2] );
+	Nes_File_Reader in;
+	RETURN_ERR( in.begin( mem ) );
+	if ( in.block_tag() != state_file_tag )
+		return "Corrupt movie index";
+	return read_state( in, entry [0], ss );
+}
+
+void Nes_Film::load_block( void* film, int block, block_t* b, int parts )
+{
+	if ( ((Nes_Film*) film)->load_block_( block, b, parts ) )
+		check( false ); // file was changed or can't be read; rest of block is left blank
+}
+
+blargg_err_t Nes_Film::load_block_( int block, block_t* b, int parts )
+{
+	map_t& m = *map_;
+	frame_count_t const first = time_offset + block * data.period();
+	frame_count_t const last  = first + data.period();
+	
+	if ( parts & data.load_joypads )
+	{
+		frame_count_t begin = max( first, m.begin );
+		frame_count_t end   = min( last, m.end );
+		for ( int i = 0; i < 2 && begin < end; i++ )
+		{
+			if ( m.joypad [i] )
+			{
+				byte const* p;
+				RETURN_ERR( m.file.data( m.joypad [i] + (begin - m.begin), end - begin, &p ) );
+				memcpy( &b->joypads [i] [begin - first], p, end - begin );
+			}
+		}
+	}
+	
+	if ( parts & data.load_states )
+	{
+		// find first snapshot in block
+		int lo = 0;
+		int hi = m.count;
+		while ( lo < hi )
+		{
+			int mid = (lo + hi) / 2;
+			if ( (frame_count_t) m.entries [mid * 3] < first )
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		
+		for ( int n = lo; n < m.count; n++ )
+		{
+			BOOST::uint32_t const* entry = &m.entries [n * 3];
+			frame_count_t time = entry [0];
+			if ( time >= last || time > m.end )
+				break;
+			
+			// keep earliest snapshot in each segment, as read_snapshot() does
+			Nes_State_& ss = b->states [snapshot_index( time ) - block * data.block_size];
+			if ( time < ss.timestamp() )
+			{
+				blargg_err_t err = read_mapped_state( m.file, entry, ss );
+				if ( err )
+				{
+					ss.clear();
+					return err;
+				}
+			}
+		}
+	}
+	
+	return 0;
+}
+
+blargg_err_t Nes_Film::open( const char* path )
+{
+	map_t* m = BLARGG_NEW map_t;
+	CHECK_ALLOC( m );
+	blargg_err_t err = m->file.open( path );
+	if ( !err )
+		err = open_map( m );
+	if ( map_ != m )
+		delete m;
+	return err;
+}
+
+blargg_err_t Nes_Film::open_map( map_t* m )
+{
+	// find index from end of file
+	long const tail = sizeof (nes_block_t) + 4;
+	long const file_size = m->file.size();
+	byte const* p;
+	long size = 0;
+	if ( file_size >= (long) sizeof (nes_block_t) + tail )
+	{
+		RETURN_ERR( m->file.data( file_size - tail, tail, &p ) );
+		nes_block_t h;
+		memcpy( &h, p + 4, sizeof h );
+		h.swap();
+		if ( h.tag == group_end_tag )
+			size = get_le32( p );
+	}
+	long const min_size = sizeof (movie_info_t) + 4 * 4;
+	long const index_offset = file_size - tail + 4 - size;
+	if ( size < min_size || index_offset < (long) sizeof (nes_block_t) )
+	{
+		// not indexed, so read it all
+		RETURN_ERR( m->file.data( 0, file_size, &p ) );
+		Mem_File_Reader in( p, file_size );
+		return read( in );
+	}
+	
+	RETURN_ERR( m->file.data( index_offset - sizeof (nes_block_t), sizeof (nes_block_t) + size, &p ) );
+	nes_block_t h;
+	memcpy( &h, p, sizeof h );
+	h.swap();
+	p += sizeof h;
+	if ( h.tag != movie_index_tag || (long) h.size != size )
+		return "Corrupt movie index";
+	
+	movie_info_t info;
+	memcpy( &info, p, sizeof info );
+	info.swap();
+	p += sizeof info;
+	m->joypad [0] = get_le32( p );
+	m->joypad [1] = get_le32( p + 4 );
+	m->count      = get_le32( p + 8 );
+	p += 12;
+	if ( m->count < 1 || m->count > (size - min_size) / 12 )
+		return "Corrupt movie index";
+	CHECK_ALLOC( m->entries = (BOOST::uint32_t*) malloc( m->count * 3 * sizeof *m->entries ) );
+	for ( int i = 0; i < m->count * 3; i++ )
+		m->entries [i] = get_le32( p + i * 4 );
+	
+	clear();
+	RETURN_ERR( begin_read( info ) );
+	has_second_joypad = (m->joypad [1] != 0);
+	m->begin = begin_;
+	m->end   = end_;
+	map_ = m;
+	data.set_loader( load_block, this );
+	
+	// at least first snapshot must be in file
+	if ( read_snapshot( begin_ ).timestamp() == invalid_frame_count )
+	{
+		clear(); // also deletes m
+		return "Corrupt movie index";
+	}
+	begin_ += info.extra; // bump back to claimed beginning
+	return 0;
+}
+
+// Streaming
+
+blargg_err_t Nes_Film::begin_stream( Auto_File_Writer out, frame_count_t window )
+{
+	require( !stream_ );
+	stream_t* s = BLARGG_NEW stream_t;
+	CHECK_ALLOC( s );
+	s->time = invalid_frame_count;
+	s->window = window;
+	if ( window && window < period_ )
+		s->window = period_; // snapshot for beginning must be kept
+	s->restart = true;
+	blargg_err_t err = s->out.begin( out, movie_stream_tag );
+	if ( !err )
+		err = s->out.flush();
+	if ( err )
+	{
+		delete s;
+		return err;
+	}
+	stream_ = s;
+	return 0;
+}
+
+blargg_err_t Nes_Film::end_stream()
+{
+	require( stream_ );
+	stream_t& s = *stream_;
+	blargg_err_t err = 0;
+	if ( !blank() && s.time != invalid_frame_count && s.time < end_ )
+		err = write_segment( s.time, end_ );
+	if ( !err )
+		err = s.out.end();
+	if ( !err )
+		err = s.out.flush();
+	delete stream_;
+	stream_ = 0;
+	return err;
+}
+
+// Called before frame at time is recorded
+blargg_err_t Nes_Film::stream_frames( frame_count_t time )
+{
+	stream_t& s = *stream_;
+	if ( !contains( time ) )
+	{
+		// film is about to be cleared
+		s.time = time;
+		s.restart = true;
+		return 0;
+	}
+	
+	if ( s.time == invalid_frame_count || (s.restart && time < s.time) )
+	{
+		// stream began after film was already recorded, so start at a snapshot
+		Nes_State_ const* ss = nearest_snapshot( time );
+		check( ss );
+		if ( !ss )
+			return "Couldn't find snapshot to begin stream at";
+		s.time = ss->timestamp();
+		s.restart = true;
+	}
+	
+	if ( time < s.time )
+		s.time = time; // recording over what was already written
+	
+	if ( time > s.time && time % period_ == 0 )
+	{
+		RETURN_ERR( write_segment( s.time, time ) );
+		s.time = time;
+		s.restart = false;
+		
+		if ( s.window && time - begin_ > s.window )
+			trim( time - s.window, end_ );
+	}
+	
+	return 0;
+}
+
+blargg_err_t Nes_Film::write_segment( frame_count_t first, frame_count_t last )
+{
+	stream_t& s = *stream_;
+	Mem_Writer mem;
+	{
+		Nes_File_Writer out;
+		RETURN_ERR( out.begin( mem, (s.restart ? movie_file_tag : stream_segment_tag) ) );
+		
+		movie_info_t info;
+		memset( &info, 0, sizeof info );
+		info.begin = first;
+		info.length = last - first;
+		info.period = period_;
+		info.has_joypad_sync = has_joypad_sync_;
+		info.joypad_count = (has_second_joypad ? 2 : 1);
+		RETURN_ERR( write_nes_state( out, info ) );
+		
+		for ( int i = 0; i < info.joypad_count; i++ )
+			RETURN_ERR( write_joypad( out, i, first, last ) );
+		
+		Nes_State_ const& ss = read_snapshot( first );
+		if ( ss.timestamp() == first )
+			RETURN_ERR( write_state( ss, out, 0 ) );
+		else
+			check( !s.restart );
+		
+		RETURN_ERR( out.end() );
+	}
+	
+	byte checksum [4];
+	set_le32( checksum, adler32( (byte const*) mem.data(), mem.size() ) );
+	RETURN_ERR( s.out.write_block_header( stream_segment_tag, mem.size() + sizeof checksum ) );
+	RETURN_ERR( s.out.write( mem.data(), mem.size() ) );
+	RETURN_ERR( s.out.write( checksum, sizeof checksum ) );
+	return s.out.flush();
+}
+
+blargg_err_t Nes_Film::read_stream( Auto_File_Reader in )
+{
+	clear();
+	Nes_File_Reader reader;
+	RETURN_ERR( reader.begin( in ) );
+	if ( reader.block_tag() != movie_stream_tag )
+		return "Not a movie stream file";
+	
+	byte* buf = 0;
+	long buf_size = 0;
+	blargg_err_t err = 0;
+	
+	// stop quietly at first segment that is cut off or damaged
+	while ( !reader.next_block() && !reader.done() )
+	{
+		if ( reader.depth() != 0 || reader.block_type() != reader.data_block ||
+				reader.block_tag() != stream_segment_tag )
+			continue;
+		
+		long size = (long) reader.remain();
+		if ( size > buf_size )
+		{
+			void* p = realloc( buf, size );
+			if ( !p )
+			{
+				err = "Out of memory";
+				break;
+			}
+			buf = (byte*) p;
+			buf_size = size;
+		}
+		if ( size < 4 || reader.read( buf, size ) )
+			break;
+		size -= 4;
+		if ( get_le32( buf + size ) != adler32( buf, size ) )
+			break;
+		
+		err = read_segment( buf, size );
+		if ( err )
+			break;
+	}
+	free( buf );
+	
+	if ( !err && blank() )
+		err = "Movie stream is empty";
+	if ( err )
+		clear();
+	return err;
+}
+
+blargg_err_t Nes_Film::read_segment( byte const* p, long size )
+{
+	Mem_File_Reader mem( p, size );
+	Nes_File_Reader in;
+	RETURN_ERR( in.begin( mem ) );
+	bool const restart = (in.block_tag() == movie_file_tag);
+	if ( !restart && in.block_tag() != stream_segment_tag )
+		return "Corrupt movie stream";
+	
+	movie_info_t info;
+	RETURN_ERR( in.next_block() );
+	if ( in.block_tag() != info.tag )
+		return "Corrupt movie stream";
+	RETURN_ERR( read_nes_state( in, &info ) );
+	frame_count_t const first = info.begin;
+	long const length = info.length;
+	if ( !info.period || length <= 0 || info.joypad_count < 1 || info.joypad_count > 2 )
+		return "Corrupt movie stream";
+	
+	// joypad data is used in place
+	byte const* joypads [2] = { 0, 0 };
+	for ( int i = 0; i < info.joypad_count; i++ )
+	{
+		RETURN_ERR( in.next_block() );
+		if ( in.block_tag() != joypad_data_tag || (long) in.remain() != length )
+			return "Corrupt movie stream";
+		joypads [i] = p + mem.tell();
+		RETURN_ERR( in.skip( length ) );
+	}
+	
+	RETURN_ERR( in.next_block() );
+	bool const has_state = (in.block_type() == in.group_begin && in.block_tag() == state_file_tag);
+	
+	if ( restart )
+	{
+		if ( !has_state )
+			return "Corrupt movie stream";
+		clear( info.period );
+	}
+	else if ( !contains( first ) || info.period != period_ )
+	{
+		return "Corrupt movie stream";
+	}
+	has_joypad_sync_ = (info.has_joypad_sync != 0);
+	
+	for ( long i = 0; i < length; i++ )
+	{
+		joypad_t joypad = joypads [0] [i];
+		if ( joypads [1] )
+			joypad |= joypads [1] [i] << 8;
+		
+		Nes_State_* ss;
+		RETURN_ERR( record_frame( first + i, joypad, &ss ) );
+		if ( ss && !i && has_state )
+		{
+			RETURN_ERR( in.enter_group() );
+			RETURN_ERR( read_state( in, first, *ss ) );
+		}
+	}
+	
+	return 0;
+}
@@ -12,6 +12,7 @@
 // See below for custom reader and writer classes that allow user data in movie files
 class Nes_Film_Writer;
 class Nes_Film_Reader;
+class Nes_Film_Branch;
 
 class Nes_Film {
 public:
@@ -40,6 +41,56 @@ public:
 	// Read entire recording from file
 	blargg_err_t read( Auto_File_Reader );
 	
+	// Open movie file without reading all of it. Files written by write() end
+	// with an index of where each snapshot is, so only that is read now and the
+	// rest is paged in as the film is accessed; huge movies open immediately and
+	// use memory in proportion to the part being played. Other movie files are
+	// read entirely. File must not be compressed, and must not be changed until
+	// film is cleared or another recording is read or opened.
+	blargg_err_t open( const char* path );
+	
+	// Stream recording to file as it's made. Each time recording reaches a
+	// multiple of period(), frames since the last one are appended to file along
+	// with their snapshot, and file is flushed. If window is non-zero, film is
+	// also trimmed to about that many recent frames, so memory use stays constant
+	// however long recording goes on. Stream ends when end_stream() is called or
+	// film is destroyed. File is only valid for read_stream().
+	blargg_err_t begin_stream( Auto_File_Writer, frame_count_t window = 0 );
+	
+	// Write frames not yet streamed and end stream file
+	blargg_err_t end_stream();
+	
+	// True if recording is being streamed to file
+	bool streaming() const { return stream_ != 0; }
+	
+	// Read recording from stream file. A stream that was cut off, for example
+	// by a crash, is read up to the last complete period written.
+	blargg_err_t read_stream( Auto_File_Reader );
+	
+	// Write recording with only its first snapshot, so file is mostly joypad data
+	// and several times smaller, more so when compressed. For each of the other
+	// snapshots write() would include, a hash is written instead. File is read
+	// normally, then the rest of the snapshots can be regenerated by replaying it
+	// (see Nes_Recorder::index_film() and begin_index()), which checks them
+	// against the hashes.
+	blargg_err_t write_inputs( Auto_File_Writer, frame_count_t period = 0 ) const;
+	
+	// Save recording to branch, replacing branch's previous contents. Data is
+	// shared rather than copied, and film and branches only keep their own copy
+	// of parts that are changed afterwards, so many alternative recordings can
+	// be kept in memory. Film must not have been opened with open(), and must be
+	// used on the same thread as its branches.
+	blargg_err_t save_branch( Nes_Film_Branch* ) const;
+	
+	// Replace recording with branch's, changing period to branch's if different.
+	// Film must not be streaming.
+	blargg_err_t load_branch( Nes_Film_Branch const& );
+	
+	// Time up to which film and branch have the same recording, so that replaying
+	// either reaches the same state at any time up to it. Negative if they don't
+	// descend from a common recording through save_branch() and load_branch().
+	frame_count_t same_until( Nes_Film_Branch const& ) const;
+	
 // Additional features
 
 	// Write trimmed recording to file, with snapshots approximately every 'period' frames
@@ -54,6 +105,24 @@ public:
 	// Average number of frames between snapshots
 	frame_count_t period() const { return period_; }
 	
+	// Set method used to compress snapshots in memory. Delta packing unpacks
+	// about twice as fast, making seeking faster, but usually packs less tightly.
+	// Only affects snapshots recorded afterwards.
+	void set_packing( Nes_Film_Data::packing_t p ) { data.set_packing( p ); }
+	Nes_Film_Data::packing_t packing() const { return data.packing(); }
+	
+	// Pack snapshots on worker's threads, or on the calling thread if NULL (see
+	// Nes_Film_Data::set_worker()). Nes_Recorder sets its own while film is set.
+	void set_worker( Nes_Worker* w ) { data.set_worker( w ); }
+	
+	// Approximate memory used by recording. Blocks shared with branches are
+	// counted in full.
+	long packed_size() const { return data.packed_size(); }
+	
+	// Time taken to unpack each group of snapshots and joypad data accessed in
+	// recording (see Nes_Latency.h)
+	Nes_Latency& unpack_latency() { return data.unpack_latency(); }
+	
 	// True if film has just been cleared
 	bool blank() const { return end_ < 0; }
 	
@@ -70,6 +139,7 @@ public:
 	
 	// True if joypad entries are 0xFF on frames that the joypad isn't read
 	bool has_joypad_sync() const { return has_joypad_sync_; }
+	void set_joypad_sync( bool b ) { has_joypad_sync_ = b; }
 	
 	// Snapshot that might have current timestamp
 	Nes_State_ const& read_snapshot( frame_count_t ) const;
@@ -80,6 +150,10 @@ public:
 	// Pointer to nearest snapshot at or before timestamp, or NULL if none
 	Nes_State_ const* nearest_snapshot( frame_count_t ) const;
 	
+	// Check regenerated snapshot against its hash in file written by write_inputs(),
+	// if there is one
+	blargg_err_t verify_snapshot( Nes_State_ const& ) const;
+	
 	typedef unsigned long joypad_t;
 	
 	// Get joypad data for frame beginning at timestamp
@@ -108,6 +182,28 @@ private:
 	bool has_joypad_sync_;
 	bool has_second_joypad;
 	
+	struct map_t;
+	map_t* map_; // file opened with open(), or NULL
+	static void load_block( void*, int, block_t*, int parts );
+	blargg_err_t load_block_( int, block_t*, int parts );
+	blargg_err_t open_map( map_t* );
+	
+	struct stream_t;
+	stream_t* stream_; // file being streamed to, or NULL
+	blargg_err_t stream_frames( frame_count_t );
+	blargg_err_t write_segment( frame_count_t first, frame_count_t last );
+	blargg_err_t read_segment( byte const*, long size );
+	
+	byte* hashes; // time and hash of snapshots omitted from file, or NULL
+	int hash_count;
+	blargg_err_t read_hashes( Nes_File_Reader& );
+	
+	// branches sharing a recording refer to the same node in a tree, or NULL
+	struct node_t;
+	mutable node_t* node;
+	static void release( node_t* );
+	void diverge( frame_count_t );
+	
 	int calc_block( frame_count_t time, int* index_out ) const;
 	int snapshot_index( frame_count_t ) const;
 	Nes_State_ const& snapshots( int ) const;
@@ -116,7 +212,9 @@ private:
 	bool contains_range( frame_count_t first, frame_count_t last ) const;
 	
 	blargg_err_t write_blocks( Nes_File_Writer&, frame_count_t first,
-			frame_count_t last, frame_count_t period ) const;
+			frame_count_t last, frame_count_t period, bool hash_only ) const;
+	blargg_err_t write_joypad( Nes_File_Writer&, int index, frame_count_t first,
+			frame_count_t last ) const;
 	blargg_err_t begin_read( movie_info_t const& );
 	blargg_err_t read_joypad( Nes_File_Reader&, int index );
 	blargg_err_t read_snapshot( Nes_File_Reader& );
@@ -124,6 +222,41 @@ private:
 	friend class Nes_Film_Reader;
 	friend class Nes_Film_Writer;
 	friend class Nes_Film_Joypad_Scanner;
+	friend class Nes_Film_Branch;
+};
+
+// Recording saved from film by Nes_Film::save_branch(), which can be loaded back
+// into a film later
+class Nes_Film_Branch {
+public:
+	Nes_Film_Branch();
+	~Nes_Film_Branch() { clear(); }
+	
+	// Free recording
+	void clear();
+	
+	// Same as for Nes_Film
+	frame_count_t begin() const { return begin_; }
+	frame_count_t end() const { return end_; }
+	frame_count_t length() const { return end() - begin(); }
+	bool blank() const { return end_ < 0; }
+	
+private:
+	// noncopyable
+	Nes_Film_Branch( Nes_Film_Branch const& );
+	Nes_Film_Branch& operator = ( Nes_Film_Branch const& );
+	
+	Nes_Film_Data::saved_t data;
+	Nes_Film::node_t* node;
+	frame_count_t begin_;
+	frame_count_t end_;
+	frame_count_t period_;
+	frame_count_t time_offset;
+	bool has_joypad_sync_;
+	bool has_second_joypad;
+	byte* hashes;
+	int hash_count;
+	friend class Nes_Film;
 };
 
 // Allows user data blocks to be written with film
@@ -26,6 +26,18 @@ Nes_Film_Data::Nes_Film_Data()
 	block_count = 0;
 	period_ = 0;
 	packer = 0;
+	spare_block = 0;
+	packing_ = pack_lz;
+	loader = 0;
+	loader_data = 0;
+	worker = 0;
+	for ( int i = 0; i < pack_slot_count; i++ )
+	{
+		slots [i].owner = this;
+		slots [i].block = 0;
+		slots [i].packer = 0;
+		slots [i].index = -1;
+	}
 	
 	BOOST_STATIC_ASSERT( sizeof active->cpu [0] % 4 == 0 );
 	BOOST_STATIC_ASSERT( sizeof active->joypad [0] % 4 == 0 );
@@ -34,6 +46,53 @@ Nes_Film_Data::Nes_Film_Data()
 	BOOST_STATIC_ASSERT( sizeof active->mapper [0] % 4 == 0 );
 	BOOST_STATIC_ASSERT( sizeof active->states [0] % 4 == 0 );
 	//BOOST_STATIC_ASSERT( offsetof (block_t,joypad0) % 4 == 0 );  // XXX
+	
+	// each snapshot component is coded as difference from previous snapshot's
+	#define ADD_REGION( member ) \
+		delta_packer.add_region( offsetof (block_t,member), sizeof active->member [0], block_size )
+	ADD_REGION( states );
+	ADD_REGION( cpu );
+	ADD_REGION( joypad );
+	ADD_REGION( apu );
+	ADD_REGION( ppu );
+	ADD_REGION( mapper );
+	ADD_REGION( spr_ram );
+	ADD_REGION( ram );
+	ADD_REGION( nametable );
+	ADD_REGION( chr );
+	ADD_REGION( sram );
+	#undef ADD_REGION
+}
+
+void Nes_Film_Data::release( comp_block_t* b )
+{
+	if ( b && !--b->refs )
+		free( b );
+}
+
+long Nes_Film_Data::worst_case( long size )
+{
+	long n = offsetof (comp_block_t, data) + Nes_Film_Packer::worst_case( size );
+	long d = offsetof (comp_block_t, data) + Nes_Film_Delta_Packer::worst_case( size );
+	return max( n, d );
+}
+
+void Nes_Film_Data::pack( comp_block_t* b, block_t const* in, Nes_Film_Packer* lz ) const
+{
+	byte const* data = (byte const*) in + b->offset;
+	long size = active_size() - b->offset;
+	if ( b->packing == pack_delta )
+		b->size = delta_packer.pack( data, size, b->data );
+	else
+		b->size = lz->pack( data, size, b->data );
+	assert( b->size <= worst_case( size ) );
+}
+
+long Nes_Film_Data::unpack( comp_block_t const* b, void* out ) const
+{
+	if ( b->packing == pack_delta )
+		return delta_packer.unpack( b->data, b->size, (byte*) out );
+	return packer->unpack( b->data, b->size, (byte*) out );
 }
 
 #ifndef NDEBUG
@@ -48,27 +107,31 @@ static void write_file( void const* in, long size, const char* path )
 	}
 }
 
-void Nes_Film_Data::debug_packer() const
+void Nes_Film_Data::debug_packer( index_t index, block_t const* block ) const
 {
-	comp_block_t* b = blocks [active_index];
-	static byte* temp = new byte [active_size() * 2];
+	comp_block_t* b = blocks [index];
+	// size differs among films, so can't be kept between calls
+	byte* temp = (byte*) malloc( active_size() * 2 );
+	if ( !temp )
+		return;
 	for ( int i = 0; i < active_size() * 2; i++ )
 		temp [i] = i;
-	long vs = packer->unpack( b->data, b->size, temp );
+	long vs = unpack( b, temp );
 	if ( vs != active_size() - b->offset )
 	{
 		dprintf( "Unpacked size differs\n" );
-		write_file( (byte*) active + b->offset, vs, "original" );
+		write_file( (byte*) block + b->offset, vs, "original" );
 		write_file( temp, vs, "error" );
 		assert( false );
 	}
-	if ( memcmp( (byte*) active + b->offset, temp, vs ) )
+	if ( memcmp( (byte*) block + b->offset, temp, vs ) )
 	{
 		dprintf( "Unpacked content differs\n" );
-		write_file( (byte*) active + b->offset, vs, "original" );
+		write_file( (byte*) block + b->offset, vs, "original" );
 		write_file( temp, vs, "error" );
 		assert( false );
 	}
+	free( temp );
 	
 	if ( 0 )
 	{
@@ -83,6 +146,110 @@ void Nes_Film_Data::debug_packer() const
 }
 #endif
 
+void Nes_Film_Data::shrink_block( index_t i ) const
+{
+	comp_block_t* b = blocks [i];
+	void* mem = realloc( b, offsetof (comp_block_t, data) + b->size * sizeof(b->data[0]) );
+	if ( mem )
+		blocks [i] = (comp_block_t*) mem;
+	else
+		check( false ); // shrink shouldn't fail, but fine if it does
+}
+
+void Nes_Film_Data::pack_slot( void* arg )
+{
+	pack_slot_t* s = (pack_slot_t*) arg;
+	comp_block_t* out = s->out;
+	s->owner->pack( out, s->block, s->packer );
+	
+	// copy to exact-size block so worst-case block can be reused by write()
+	s->packed = out;
+	long size = offsetof (comp_block_t, data) + out->size * sizeof(out->data[0]);
+	comp_block_t* b = (comp_block_t*) malloc( size );
+	if ( b )
+	{
+		memcpy( b, out, size );
+		s->packed = b;
+	}
+}
+
+void Nes_Film_Data::set_worker( Nes_Worker* w )
+{
+	finish_packing();
+	worker = w;
+}
+
+void Nes_Film_Data::finish_packing() const
+{
+	if ( worker )
+		worker->wait(); // might also wait for other data's blocks
+	for ( int i = 0; i < pack_slot_count; i++ )
+	{
+		pack_slot_t& s = slots [i];
+		if ( s.index >= 0 )
+		{
+			blocks [s.index] = s.packed;
+			if ( s.packed != s.out )
+			{
+				// only keep a block big enough for any write()
+				if ( !spare_block && !s.out->offset )
+					spare_block = s.out;
+				else
+					free( s.out );
+			}
+			#ifndef NDEBUG
+				debug_packer( s.index, s.block );
+			#endif
+			s.index = -1;
+		}
+	}
+}
+
+Nes_Film_Data::pack_slot_t* Nes_Film_Data::idle_slot() const
+{
+	if ( !worker || !worker->thread_count() )
+		return 0;
+	
+	// finished jobs can be collected without waiting
+	if ( !worker->busy() )
+		finish_packing();
+	
+	pack_slot_t* s = 0;
+	for ( int i = 0; i < pack_slot_count && !s; i++ )
+		if ( slots [i].index < 0 )
+			s = &slots [i];
+	
+	if ( !s )
+	{
+		// packing has fallen behind recording
+		finish_packing();
+		s = &slots [0];
+	}
+	
+	if ( !s->block )
+	{
+		if ( !s->packer && !(s->packer = BLARGG_NEW Nes_Film_Packer) )
+			return 0;
+		s->block = (block_t*) calloc( active_size(), 1 );
+		if ( !s->block )
+			return 0;
+		s->packer->prepare( s->block, active_size() );
+	}
+	return s;
+}
+
+void Nes_Film_Data::free_slots()
+{
+	finish_packing();
+	for ( int i = 0; i < pack_slot_count; i++ )
+	{
+		free( slots [i].block );
+		slots [i].block = 0;
+	}
+	free( spare_block );
+	spare_block = 0;
+}
+
 void Nes_Film_Data::flush_active() const
 {
 	if ( active_dirty )
@@ -93,19 +260,32 @@ void Nes_Film_Data::flush_active() const
 		comp_block_t* b = blocks [active_index];
 		assert( b && !b->size ); // should have been reallocated in write()
 		check( b->offset == joypad_only_ );
-		b->size = packer->pack( (byte*) active + b->offset, active_size() - b->offset, b->data );
-		assert( b->size <= packer->worst_case( active_size() - b->offset ) );
 		
-		// shrink allocation
-        void* mem = realloc( b, offsetof (comp_block_t, data) + b->size * sizeof(b->data[0]) );
-		if ( mem )
-			blocks [active_index] = (comp_block_t*) mem;
+		pack_slot_t* s = idle_slot();
+		if ( s )
+		{
+			// pack in background and continue with the slot's block
+			block_t* block = s->block;
+			s->block = active;
+			active = block;
+			
+			Nes_Film_Packer* p = s->packer;
+			s->packer = packer;
+			packer = p;
+			
+			s->out = b;
+			s->index = active_index;
+			worker->add( pack_slot, s );
+		}
 		else
-			check( false ); // shrink shouldn't fail, but fine if it does
-		
-		#ifndef NDEBUG
-			debug_packer();
-		#endif
+		{
+			// no worker thread or out of memory for slot; pack in place
+			pack( b, active, packer );
+			shrink_block( active_index );
+			#ifndef NDEBUG
+				debug_packer( active_index, active );
+			#endif
+		}
 	}
 	active_index = -1;
 }
@@ -117,6 +297,18 @@ void Nes_Film_Data::init_states() const
 	b->garbage0 = 1;
 	b->garbage1 = 2;
 	b->garbage2 = 3;
+	set_pointers();
+	for ( int j = 0; j < block_size; j++ )
+		b->states [j].set_timestamp( invalid_frame_count );
+}
+
+void Nes_Film_Data::set_pointers() const
+{
+	// a block may have been packed from another buffer, so its pointers are
+	// always recalculated
+	block_t* b = active;
+	b->joypads [0] = &b->joypad0 [0];
+	b->joypads [1] = &b->joypad0 [period_];
 	for ( int j = 0; j < block_size; j++ )
 	{
 		Nes_State_& s = b->states [j];
@@ -130,31 +322,48 @@ void Nes_Film_Data::init_states() const
 		s.spr_ram   = b->spr_ram [j];
 		s.nametable = b->nametable [j];
 		s.chr       = b->chr [j];
-		s.set_timestamp( invalid_frame_count );
 	}
 }
 
+inline void Nes_Film_Data::load( index_t i, int parts ) const
+{
+	if ( joypad_only_ )
+		parts &= ~load_states; // states aren't kept in this mode
+	if ( loader && parts )
+		loader( loader_data, i, active, parts );
+}
+
 void Nes_Film_Data::access( index_t i ) const
 {
 	assert( (unsigned) i < (unsigned) block_count );
 	if ( active_dirty )
 		flush_active();
+	for ( int n = 0; n < pack_slot_count; n++ )
+		if ( slots [n].index == i )
+			finish_packing();
 	active_index = i;
 	comp_block_t* b = blocks [i];
 	if ( b )
 	{
+		Nes_Latency::timer_t timer( unpack_latency_ );
 		assert( b->size );
-		long size = packer->unpack( b->data, b->size, (byte*) active + b->offset );
+		long size = unpack( b, (byte*) active + b->offset );
 		assert( b->offset + size == active_size() );
 		if ( b->offset )
+		{
 			init_states();
+			load( i, load_states );
+		}
+		else
+		{
+			set_pointers();
+		}
 	}
 	else
 	{
-		active->joypads [0] = &active->joypad0 [0];
-		active->joypads [1] = &active->joypad0 [period_];
 		init_states();
 		memset( active->joypad0, 0, period_ * 2 );
+		load( i, load_states | load_joypads );
 	}
 }
 
@@ -166,12 +375,28 @@ Nes_Film_Data::block_t* Nes_Film_Data::write( int i )
 	if ( !active_dirty )
 	{
 		// preallocate now to avoid losing write when flushed later
-		long size = packer->worst_case( active_size() - joypad_only_ );
-		comp_block_t* new_mem = (comp_block_t*) realloc( blocks [i], size );
-		if ( !new_mem )
-			return 0;
+		comp_block_t* new_mem = spare_block;
+		comp_block_t* old = blocks [i];
+		if ( new_mem )
+		{
+			spare_block = 0;
+			release( old );
+		}
+		else
+		{
+			// block shared with saved copies is left to them
+			bool shared = (old && old->refs > 1);
+			new_mem = (comp_block_t*) realloc( (shared ? 0 : old),
+					worst_case( active_size() - joypad_only_ ) );
+			if ( !new_mem )
+				return 0;
+			if ( shared )
+				old->refs--;
+		}
+		new_mem->refs = 1;
 		new_mem->size = 0;
 		new_mem->offset = joypad_only_;
+		new_mem->packing = (joypad_only_ ? pack_lz : packing_); // regions assume whole block
 		blocks [i] = new_mem;
 		active_dirty = true;
 	}
@@ -192,9 +417,10 @@ blargg_err_t Nes_Film_Data::resize( int new_count )
 		
 		if ( active_index >= new_count )
 			flush_active();
+		finish_packing();
 		
 		for ( int i = new_count; i < block_count; i++ )
-			free( blocks [i] );
+			release( blocks [i] );
 		
 		block_count = new_count;
 		void* new_blocks = realloc( blocks, new_count * sizeof *blocks );
@@ -236,11 +462,58 @@ void Nes_Film_Data::clear( frame_count_t period )
 	if ( resize( 0 ) )
 		check( false ); // shrink should never fail
 	joypad_only_ = false;
+	loader = 0;
+	loader_data = 0;
+	free_slots();
 	period_ = period * block_size;
 	free( active );
 	active = 0;
 }
 
+void Nes_Film_Data::free_block( index_t i )
+{
+	require( (unsigned) i < (unsigned) block_count );
+	if ( i == active_index )
+	{
+		active_dirty = false;
+		active_index = -1;
+	}
+	for ( int n = 0; n < pack_slot_count; n++ )
+		if ( slots [n].index == i )
+			finish_packing();
+	release( blocks [i] );
+	blocks [i] = 0;
+}
+
+long Nes_Film_Data::packed_size( index_t i ) const
+{
+	require( (unsigned) i < (unsigned) block_count );
+	comp_block_t const* b = blocks [i];
+	if ( !b )
+		return 0;
+	
+	// block being packed by worker thread can't be examined
+	for ( int n = 0; n < pack_slot_count; n++ )
+		if ( slots [n].index == i )
+			return worst_case( active_size() - b->offset );
+	
+	if ( !b->size )
+		return worst_case( active_size() - b->offset ); // not packed yet
+	
+	return offsetof (comp_block_t, data) + b->size * sizeof b->data [0];
+}
+
+long Nes_Film_Data::packed_size() const
+{
+	// pack active block so sizes are exact
+	flush_active();
+	finish_packing();
+	long total = block_count * sizeof *blocks;
+	for ( int i = 0; i < block_count; i++ )
+		total += packed_size( i );
+	return total;
+}
+
 void Nes_Film_Data::trim( int begin, int new_count )
 {
 	require( 0 <= begin && begin + new_count <= block_count );
@@ -249,11 +522,12 @@ void Nes_Film_Data::trim( int begin, int new_count )
 	{
 		if ( begin || active_index >= new_count )
 			flush_active();
+		finish_packing();
 		
 		if ( begin )
 		{
 			for ( int i = 0; i < begin; i++ )
-				free( blocks [i] );
+				release( blocks [i] );
 			memmove( &blocks [0], &blocks [begin], (block_count - begin) * sizeof *blocks );
 			block_count -= begin;
 		}
@@ -263,11 +537,69 @@ void Nes_Film_Data::trim( int begin, int new_count )
 	}
 }
 
+// Saving
+
+blargg_err_t Nes_Film_Data::save( saved_t* out ) const
+{
+	require( !loader ); // blocks not loaded yet would be missing
+	
+	// active block must be packed before it can be shared
+	flush_active();
+	finish_packing();
+	
+	comp_block_t** new_blocks = (comp_block_t**) malloc( block_count * sizeof *blocks );
+	CHECK_ALLOC( new_blocks || !block_count );
+	for ( int i = 0; i < block_count; i++ )
+	{
+		new_blocks [i] = blocks [i];
+		if ( blocks [i] )
+			blocks [i]->refs++;
+	}
+	
+	out->clear();
+	out->blocks = new_blocks;
+	out->count = block_count;
+	out->period = period_;
+	return 0;
+}
+
+blargg_err_t Nes_Film_Data::restore( saved_t const& in )
+{
+	require( in.period == period_ || !in.count );
+	
+	// changes to active block belong to blocks being replaced
+	active_dirty = false;
+	active_index = -1;
+	loader = 0;
+	loader_data = 0;
+	RETURN_ERR( resize( 0 ) );
+	RETURN_ERR( resize( in.count ) );
+	for ( int i = 0; i < block_count; i++ )
+	{
+		blocks [i] = in.blocks [i];
+		if ( blocks [i] )
+			blocks [i]->refs++;
+	}
+	return 0;
+}
+
+void Nes_Film_Data::saved_t::clear()
+{
+	for ( int i = 0; i < count; i++ )
+		release( blocks [i] );
+	free( blocks );
+	blocks = 0;
+	count = 0;
+}
+
 Nes_Film_Data::~Nes_Film_Data()
 {
 	if ( resize( 0 ) )
 		check( false ); // shrink should never fail
+	free_slots();
 	free( active );
 	delete packer;
+	for ( int i = 0; i < pack_slot_count; i++ )
+		delete slots [i].packer;
 }
 
@@ -8,8 +8,11 @@
 
 #include "Nes_State.h"
 #include "Nes_Film_Packer.h"
+#include "Nes_Worker.h"
+#include "Nes_Latency.h"
 
 class Nes_Film_Data {
+	struct comp_block_t;
 public:
 	Nes_Film_Data();
 	~Nes_Film_Data();
@@ -48,30 +51,129 @@ public:
 	block_t* alloc_joypad2( index_t i ) { return write( i ); }
 	void joypad_only( bool );
 	
+	// Discard block's data, as if it had never been written
+	void free_block( index_t );
+	
+	// Approximate memory used by block's packed data, or 0 if block is blank
+	long packed_size( index_t ) const;
+	
+	// Approximate memory used by packed data of all blocks
+	long packed_size() const;
+	
+	// Time taken to unpack each block accessed, including loading any of it that
+	// isn't in memory (see Nes_Latency.h)
+	Nes_Latency& unpack_latency() { return unpack_latency_; }
+	Nes_Latency const& unpack_latency() const { return unpack_latency_; }
+	
+	// Set function to fill in blocks that haven't been written, for films whose
+	// data is kept outside memory. It's called whenever such a block is accessed,
+	// with the block's snapshots invalidated and joypad data cleared, and should
+	// fill in the parts requested. Cleared by clear().
+	enum { load_states = 1, load_joypads = 2 };
+	typedef void (*load_func_t)( void* data, index_t, block_t*, int parts );
+	void set_loader( load_func_t f, void* data ) { loader = f; loader_data = data; }
+	
+	// Method used to compress blocks. Only affects blocks written afterwards.
+	enum packing_t {
+		pack_lz,    // match repeated words within block (default)
+		pack_delta  // code each snapshot as difference from previous one in block
+	};
+	void set_packing( packing_t p ) { packing_ = p; }
+	packing_t packing() const { return packing_; }
+	
+	// Pack blocks on worker's threads (see Nes_Worker.h), or on the calling thread
+	// if NULL (the default). Worker can be shared by several Nes_Film_Data used
+	// from the same thread, and must not be destroyed while set.
+	void set_worker( Nes_Worker* );
+	
+	// Blocks saved by save(). Packed blocks are shared with the data they were
+	// saved from rather than copied, and a shared block is only copied when one
+	// of its users writes to it. Blocks are reference counted without locking,
+	// so data and saved copies must only be used on one thread.
+	class saved_t {
+	public:
+		saved_t() { blocks = 0; count = 0; period = 0; }
+		~saved_t() { clear(); }
+		void clear();
+	private:
+		// noncopyable
+		saved_t( saved_t const& );
+		saved_t& operator = ( saved_t const& );
+		
+		comp_block_t** blocks;
+		int count;
+		frame_count_t period;
+		friend class Nes_Film_Data;
+	};
+	
+	// Save blocks to 'out', replacing its previous contents. Can't be used while a
+	// loader is set.
+	blargg_err_t save( saved_t* out ) const;
+	
+	// Replace blocks with saved ones, which must have the same period
+	blargg_err_t restore( saved_t const& );
+	
 private:
 	struct comp_block_t
 	{
+		long refs; // number of block lists sharing this block
 		long size;
 		long offset;
+		long packing;
 		BOOST::uint8_t data [1024 * 1024L];
 	};
 	comp_block_t** blocks;
 	int block_count;
 	frame_count_t period_;
-	block_t* active;
+	mutable block_t* active;
 	mutable int active_index;
 	mutable bool active_dirty;
 	long joypad_only_;
-	Nes_Film_Packer* packer;
+	mutable Nes_Film_Packer* packer; // prepared for active
+	Nes_Film_Delta_Packer delta_packer;
+	packing_t packing_;
+	load_func_t loader;
+	void* loader_data;
+	mutable Nes_Latency unpack_latency_;
+	
+	// Doesn't use any packer, so it's safe to call from a worker thread
+	static long worst_case( long size );
+	static void release( comp_block_t* );
+	void pack( comp_block_t*, block_t const*, Nes_Film_Packer* ) const;
+	long unpack( comp_block_t const*, void* out ) const;
+	
+	// With a worker set, flushed blocks are packed on its threads. The active
+	// block is swapped with an idle slot's block, so recording doesn't wait for
+	// packing unless all slots are still busy.
+	enum { pack_slot_count = 2 };
+	struct pack_slot_t
+	{
+		Nes_Film_Data const* owner;
+		block_t* block;
+		Nes_Film_Packer* packer; // prepared for block
+		comp_block_t* out;       // worst-case size, allocated by write()
+		comp_block_t* packed;    // exact-size copy of out, or out if copy failed
+		index_t index;           // block being packed, or -1 if idle
+	};
+	mutable pack_slot_t slots [pack_slot_count];
+	mutable comp_block_t* spare_block; // worst-case block for write() to reuse
+	Nes_Worker* worker;
+	static void pack_slot( void* );
+	pack_slot_t* idle_slot() const;
+	void finish_packing() const;
+	void free_slots();
+	void shrink_block( index_t ) const;
 	
-	void debug_packer() const;
+	void debug_packer( index_t, block_t const* ) const;
 	void flush_active() const;
 	void init_active() const;
 	void init_states() const;
+	void set_pointers() const;
 	void invalidate_active();
 	void access( index_t ) const;
+	void load( index_t, int parts ) const;
 	// must be multiple of 4 for packer
-	long active_size() const { return (offsetof (block_t,joypad0) + 3) & ~3; }
+	long active_size() const { return (offsetof (block_t,joypad0) + period_ * 2 + 3) & ~3; }
 };
 
 inline Nes_Film_Data::block_t const& Nes_Film_Data::read( int i ) const
@@ -218,3 +218,169 @@ long Nes_Film_Packer::unpack( byte const* in_begin, long in_size, byte* out_begi
 	return out_size;
 }
 
+// Nes_Film_Delta_Packer
+
+// Packed data is a series of runs, each a header word holding the number of
+// zero words in the high 16 bits and the number of literal words following
+// the header in the low 16 bits.
+
+void Nes_Film_Delta_Packer::add_region( long offset, long size, int count )
+{
+	require( region_count < max_regions );
+	require( offset % 4 == 0 && size % 4 == 0 && size > 0 && count > 0 );
+	region_t& r = regions [region_count++];
+	r.size  = size / 4;
+	r.begin = offset / 4 + r.size;
+	r.end   = offset / 4 + r.size * count;
+	require( region_count == 1 || r.begin - r.size >= regions [region_count - 2].end );
+}
+
+// Run-length coder for a stream of words
+class Nes_Delta_Encoder {
+public:
+	typedef BOOST::uint32_t uint32_t;
+	
+	Nes_Delta_Encoder( uint32_t* out_ )
+	{
+		out = out_;
+		begin_run( 0 );
+	}
+	
+	void write( uint32_t n )
+	{
+		if ( !literals )
+		{
+			if ( !n )
+			{
+				if ( ++zeros > 0xFFFF )
+				{
+					--zeros;
+					end_run();
+					begin_run( 1 );
+				}
+				return;
+			}
+		}
+		else if ( !n )
+		{
+			// a single zero is cheaper to keep in the literal run
+			if ( ++pending < 2 )
+				return;
+			end_run();
+			begin_run( 2 );
+			return;
+		}
+		
+		if ( pending )
+		{
+			*out++ = 0;
+			literals++;
+			pending = 0;
+		}
+		
+		if ( literals >= max_literals )
+		{
+			end_run();
+			begin_run( 0 );
+		}
+		*out++ = n;
+		literals++;
+	}
+	
+	uint32_t* end()
+	{
+		end_run();
+		if ( pending )
+			*out++ = (uint32_t) pending << 16;
+		return out;
+	}
+	
+private:
+	enum { max_literals = 0xFFF0 };
+	uint32_t* out;
+	uint32_t* header;
+	long zeros;
+	long literals;
+	long pending; // zeros following literals, not yet written
+	
+	void begin_run( long z )
+	{
+		header = out++;
+		zeros = z;
+		literals = 0;
+		pending = 0;
+	}
+	
+	void end_run() { *header = (uint32_t) zeros << 16 | literals; }
+};
+
+long Nes_Film_Delta_Packer::pack( byte const* in_begin, long in_size, byte* out_begin ) const
+{
+	assert( (in_size & 3) == 0 );
+	uint32_t const* in = (uint32_t const*) in_begin;
+	long const size = in_size >> 2;
+	Nes_Delta_Encoder enc( (uint32_t*) out_begin );
+	
+	long pos = 0;
+	for ( int r = 0; r <= region_count; r++ )
+	{
+		// data before region
+		long end = (r < region_count ? regions [r].begin : size);
+		if ( end > size )
+			end = size;
+		for ( ; pos < end; pos++ )
+			enc.write( in [pos] );
+		
+		if ( r < region_count )
+		{
+			// records XORed with previous record
+			long const delta = regions [r].size;
+			end = regions [r].end;
+			if ( end > size )
+				end = size;
+			for ( ; pos < end; pos++ )
+				enc.write( in [pos] ^ in [pos - delta] );
+		}
+	}
+	
+	long out_size = (byte*) enc.end() - out_begin;
+	assert( out_size <= worst_case( in_size ) );
+	return out_size;
+}
+
+long Nes_Film_Delta_Packer::unpack( byte const* packed_in, long packed_size, byte* out_begin ) const
+{
+	assert( (packed_size & 3) == 0 );
+	uint32_t const* in = (uint32_t const*) packed_in;
+	uint32_t const* const in_end = (uint32_t const*) (packed_in + packed_size);
+	uint32_t* out = (uint32_t*) out_begin;
+	
+	// expand runs
+	while ( in < in_end )
+	{
+		uint32_t header = *in++;
+		long zeros = header >> 16;
+		long literals = header & 0xFFFF;
+		assert( in + literals <= in_end );
+		memset( out, 0, zeros * sizeof *out );
+		out += zeros;
+		memcpy( out, in, literals * sizeof *out );
+		out += literals;
+		in += literals;
+	}
+	
+	// undo deltas in order so each record is XORed with already-restored one
+	long const size = out - (uint32_t*) out_begin;
+	out = (uint32_t*) out_begin;
+	for ( int r = 0; r < region_count; r++ )
+	{
+		long const delta = regions [r].size;
+		long end = regions [r].end;
+		if ( end > size )
+			end = size;
+		for ( long pos = regions [r].begin; pos < end; pos++ )
+			out [pos] ^= out [pos - delta];
+	}
+	
+	return size * 4;
+}
@@ -13,7 +13,7 @@ public:
 	void prepare( void const* begin, long size );
 	
 	// Worst-case output size for given input size
-	long worst_case( long in_size ) const { return in_size + 8; }
+	static long worst_case( long in_size ) { return in_size + 8; }
 	
 	typedef unsigned char byte;
 	long pack( byte const* in, long size, byte* packed_out );
@@ -28,5 +28,41 @@ private:
 	uint32_t const* dict [dict_size];
 };
 
+// Snapshot compressor that codes each record as its difference from the
+// previous one, for data holding the same components of several consecutive
+// snapshots. Records after the first in a region are XORed with the record
+// before them, then runs of zero words are run-length coded. Keeps no state
+// between calls, so one packer can be shared among threads.
+class Nes_Film_Delta_Packer {
+public:
+	Nes_Film_Delta_Packer() { region_count = 0; }
+	
+	// Add region of 'count' records of 'size' bytes each, beginning at 'offset'
+	// in data. Offset and size must be multiples of 4, and regions must be added
+	// in increasing order without overlapping. Data outside regions is
+	// run-length coded without any delta.
+	enum { max_regions = 16 };
+	void add_region( long offset, long size, int count );
+	
+	// Worst-case output size for given input size
+	static long worst_case( long in_size ) { return in_size + in_size / max_literals + 8; }
+	
+	typedef unsigned char byte;
+	long pack( byte const* in, long size, byte* packed_out ) const;
+	
+	long unpack( byte const* packed_in, long packed_size, byte* out ) const;
+private:
+	enum { max_literals = 0xFFF0 };
+	typedef BOOST::uint32_t uint32_t;
+	struct region_t
+	{
+		long begin; // first word of second record
+		long end;
+		long size;  // words per record
+	};
+	region_t regions [max_regions];
+	int region_count;
+};
+
 #endif
 
@@ -20,10 +20,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
 void Nes_Fme7_Apu::reset()
 {
-	last_time = 0;
-	
 	for ( int i = 0; i < osc_count; i++ )
+	{
 		oscs [i].last_amp = 0;
+		oscs [i].last_time = 0;
+	}
 	
 	fme7_apu_state_t* state = this;
 	memset( state, 0, sizeof *state );
@@ -39,82 +40,79 @@ unsigned char Nes_Fme7_Apu::amp_table [16] =
 	#undef ENTRY
 };
 
-void Nes_Fme7_Apu::run_until( blip_time_t end_time )
+void Nes_Fme7_Apu::run_osc( int index, blip_time_t end_time )
 {
+	blip_time_t const last_time = oscs [index].last_time;
 	require( end_time >= last_time );
+	oscs [index].last_time = end_time;
+	
+	int mode = regs [7] >> index;
+	int vol_mode = regs [010 + index];
+	int volume = amp_table [vol_mode & 0x0f];
 	
-	for ( int index = 0; index < osc_count; index++ )
+	if ( !oscs [index].output )
+		return;
+	
+	// check for unsupported mode
+	#ifndef NDEBUG
+		if ( (mode & 011) <= 001 && vol_mode & 0x1f )
+			dprintf( "FME7 used unimplemented sound mode: %02X, vol_mode: %02X\n",
+					mode, vol_mode & 0x1f );
+	#endif
+	
+	if ( (mode & 001) | (vol_mode & 0x10) )
+		volume = 0; // noise and envelope aren't supported
+	
+	// period
+	int const period_factor = 16;
+	unsigned period = (regs [index * 2 + 1] & 0x0f) * 0x100 * period_factor +
+			regs [index * 2] * period_factor;
+	if ( period < 50 ) // around 22 kHz
 	{
-		int mode = regs [7] >> index;
-		int vol_mode = regs [010 + index];
-		int volume = amp_table [vol_mode & 0x0f];
-		
-		if ( !oscs [index].output )
-			continue;
-		
-		// check for unsupported mode
-		#ifndef NDEBUG
-			if ( (mode & 011) <= 001 && vol_mode & 0x1f )
-				dprintf( "FME7 used unimplemented sound mode: %02X, vol_mode: %02X\n",
-						mode, vol_mode & 0x1f );
-		#endif
-		
-		if ( (mode & 001) | (vol_mode & 0x10) )
-			volume = 0; // noise and envelope aren't supported
-		
-		// period
-		int const period_factor = 16;
-		unsigned period = (regs [index * 2 + 1] & 0x0f) * 0x100 * period_factor +
-				regs [index * 2] * period_factor;
-		if ( period < 50 ) // around 22 kHz
-		{
-			volume = 0;
-			if ( !period ) // on my AY-3-8910A, period doesn't have extra one added
-				period = period_factor;
-		}
-		
-		// current amplitude
-		int amp = volume;
-		if ( !phases [index] )
-			amp = 0;
-		int delta = amp - oscs [index].last_amp;
-		if ( delta )
-		{
-			oscs [index].last_amp = amp;
-			synth.offset( last_time, delta, oscs [index].output );
-		}
+		volume = 0;
+		if ( !period ) // on my AY-3-8910A, period doesn't have extra one added
+			period = period_factor;
+	}
+	
+	// current amplitude
+	int amp = volume;
+	if ( !phases [index] )
+		amp = 0;
+	int delta = amp - oscs [index].last_amp;
+	if ( delta )
+	{
+		oscs [index].last_amp = amp;
+		synth.offset( last_time, delta, oscs [index].output );
+	}
+	
+	blip_time_t time = last_time + delays [index];
+	if ( time < end_time )
+	{
+		Blip_Buffer* const osc_output = oscs [index].output;
+		int delta = amp * 2 - volume;
 		
-		blip_time_t time = last_time + delays [index];
-		if ( time < end_time )
+		if ( volume )
 		{
-			Blip_Buffer* const osc_output = oscs [index].output;
-			int delta = amp * 2 - volume;
-			
-			if ( volume )
-			{
-				do
-				{
-					delta = -delta;
-					synth.offset_inline( time, delta, osc_output );
-					time += period;
-				}
-				while ( time < end_time );
-				
-				oscs [index].last_amp = (delta + volume) >> 1;
-				phases [index] = (delta > 0);
-			}
-			else
+			do
 			{
-				// maintain phase when silent
-				int count = (end_time - time + period - 1) / period;
-				phases [index] ^= count & 1;
-				time += (long) count * period;
+				delta = -delta;
+				synth.offset_inline( time, delta, osc_output );
+				time += period;
 			}
+			while ( time < end_time );
+			
+			oscs [index].last_amp = (delta + volume) >> 1;
+			phases [index] = (delta > 0);
+		}
+		else
+		{
+			// maintain phase when silent
+			int count = (end_time - time + period - 1) / period;
+			phases [index] ^= count & 1;
+			time += (long) count * period;
 		}
-		
-		delays [index] = time - end_time;
 	}
 	
-	last_time = end_time;
+	delays [index] = time - end_time;
 }
 
@@ -56,13 +56,13 @@ private:
 	struct {
 		Blip_Buffer* output;
 		int last_amp;
+		blip_time_t last_time; // each oscillator is only run when necessary
 	} oscs [osc_count];
-	blip_time_t last_time;
 	
 	enum { amp_range = 192 }; // can be any value; this gives best error/quality tradeoff
 	Blip_Synth<blip_good_quality,1> synth;
 	
-	void run_until( blip_time_t );
+	void run_osc( int index, blip_time_t );
 };
 
 inline void Nes_Fme7_Apu::volume( double v )
@@ -106,17 +106,28 @@ inline void Nes_Fme7_Apu::write_data( blip_time_t time, int data )
 		return;
 	}
 	
-	run_until( time );
+	// run only oscillators affected by register (noise and envelope aren't emulated)
+	if ( latch < 6 )
+		run_osc( latch >> 1, time );
+	else if ( latch == 7 )
+		for ( int i = 0; i < osc_count; i++ )
+			run_osc( i, time );
+	else if ( latch >= 010 && latch < 010 + osc_count )
+		run_osc( latch - 010, time );
+	
 	regs [latch] = data;
 }
 
 inline void Nes_Fme7_Apu::end_frame( blip_time_t time )
 {
-	if ( time > last_time )
-		run_until( time );
-	
-	assert( last_time >= time );
-	last_time -= time;
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		if ( time > oscs [i].last_time )
+			run_osc( i, time );
+		
+		assert( oscs [i].last_time >= time );
+		oscs [i].last_time -= time;
+	}
 }
 
 inline void Nes_Fme7_Apu::save_state( fme7_apu_state_t* out ) const
@@ -0,0 +1,121 @@
+// Nes_Emu 0.7.0
+
+#include "Nes_Latency.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef NES_LATENCY_STATS
+	#ifdef _WIN32
+		#include <windows.h>
+	#else
+		#include <time.h>
+	#endif
+#endif
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+void Nes_Latency::clear()
+{
+	memset( counts, 0, sizeof counts );
+	count_ = 0;
+	total = 0;
+	max_ = 0;
+}
+
+// Durations below 4 each have their own range. Above that, each power of two is
+// split into four ranges, so range is found from the top three bits.
+int Nes_Latency::range( unsigned long usec )
+{
+	if ( usec < 4 )
+		return usec;
+	int shift = 0;
+	while ( usec >> shift >= 8 )
+		shift++;
+	return shift * 4 + (int) (usec >> shift);
+}
+
+unsigned long Nes_Latency::range_end( int r )
+{
+	if ( r < 8 )
+		return r;
+	int shift = r / 4 - 1;
+	return ((unsigned long) (r % 4 + 5) << shift) - 1;
+}
+
+void Nes_Latency::add( unsigned long usec )
+{
+	int r = range( usec );
+	if ( r >= range_count )
+		r = range_count - 1;
+	counts [r]++;
+	count_++;
+	total += usec;
+	if ( max_ < usec )
+		max_ = usec;
+}
+
+unsigned long Nes_Latency::mean() const
+{
+	if ( !count_ )
+		return 0;
+	return (unsigned long) (total / count_ + 0.5);
+}
+
+unsigned long Nes_Latency::percentile( int percent ) const
+{
+	require( 0 <= percent && percent <= 100 );
+	double needed = (double) count_ * percent / 100;
+	long sum = 0;
+	for ( int r = 0; r < range_count; r++ )
+	{
+		sum += counts [r];
+		if ( counts [r] && sum >= needed )
+		{
+			unsigned long end = range_end( r );
+			return (end < max_ ? end : max_);
+		}
+	}
+	return max_;
+}
+
+blargg_err_t Nes_Latency::write_json( Data_Writer& out ) const
+{
+	char str [256];
+	long size = sprintf( str, "{\"count\": %ld, \"mean_us\": %lu, \"p50_us\": %lu, "
+			"\"p90_us\": %lu, \"p99_us\": %lu, \"max_us\": %lu}", count_, mean(),
+			percentile( 50 ), percentile( 90 ), percentile( 99 ), max_ );
+	return out.write( str, size );
+}
+
+unsigned long Nes_Latency::now()
+{
+	#if !defined (NES_LATENCY_STATS)
+		return 0;
+	#elif defined (_WIN32)
+		LARGE_INTEGER freq, count;
+		QueryPerformanceFrequency( &freq );
+		QueryPerformanceCounter( &count );
+		// split to avoid overflow
+		return (unsigned long) (count.QuadPart / freq.QuadPart * 1000000 +
+				count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+	#elif defined (CLOCK_MONOTONIC)
+		timespec ts;
+		clock_gettime( CLOCK_MONOTONIC, &ts );
+		return (unsigned long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	#else
+		return (unsigned long) ((double) clock() * 1000000 / CLOCKS_PER_SEC);
+	#endif
+}
+
@@ -0,0 +1,72 @@
+
+// Latency statistics for timing film operations
+
+// Nes_Emu 0.7.0
+
+#ifndef NES_LATENCY_H
+#define NES_LATENCY_H
+
+#include "blargg_common.h"
+#include "abstract_file.h"
+
+// Distribution of how long an operation takes, in microseconds. Durations are
+// counted in ranges that are each about 19% wider than the previous, so memory
+// use is fixed however many are added, and percentiles are accurate to about
+// that much. Durations are only measured if compiled with NES_LATENCY_STATS
+// defined; otherwise timer_t does nothing and all counts stay zero.
+class Nes_Latency {
+public:
+	Nes_Latency() { clear(); }
+	
+	// Remove all durations
+	void clear();
+	
+	// Add duration of one operation
+	void add( unsigned long usec );
+	
+	// Number of durations added
+	long count() const { return count_; }
+	
+	// Average and longest duration, or 0 if none were added
+	unsigned long mean() const;
+	unsigned long max() const { return max_; }
+	
+	// Duration that 'percent' of operations took no longer than, rounded up to
+	// the end of its range
+	unsigned long percentile( int percent ) const;
+	
+	// Write count, mean, 50th, 90th and 99th percentiles, and maximum as JSON object
+	blargg_err_t write_json( Data_Writer& ) const;
+	
+	// Current time in microseconds from a steady clock, or 0 if NES_LATENCY_STATS
+	// isn't defined. Wraps around, so only differences are meaningful.
+	static unsigned long now();
+	
+	// Add time from construction to destruction of timer
+	class timer_t;
+	
+private:
+	enum { range_count = 128 };
+	long counts [range_count];
+	long count_;
+	double total;
+	unsigned long max_;
+	static int range( unsigned long usec );
+	static unsigned long range_end( int );
+};
+
+class Nes_Latency::timer_t {
+public:
+#ifdef NES_LATENCY_STATS
+	timer_t( Nes_Latency& l ) : latency( l ), start( now() ) { }
+	~timer_t() { latency.add( now() - start ); }
+private:
+	Nes_Latency& latency;
+	unsigned long start;
+#else
+	timer_t( Nes_Latency& ) { }
+#endif
+};
+
+#endif
+
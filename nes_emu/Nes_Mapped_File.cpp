@@ -0,0 +1,119 @@
+
+// Nes_Emu 0.7.0
+
+#include "Nes_Mapped_File.h"
+
+#include <stdlib.h>
+#include "abstract_file.h"
+
+#ifdef NES_MAPPED_FILES
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+Nes_Mapped_File::Nes_Mapped_File()
+{
+	size_ = 0;
+	map = 0;
+	file = 0;
+	buf = 0;
+	buf_size = 0;
+}
+
+Nes_Mapped_File::~Nes_Mapped_File()
+{
+	close();
+}
+
+void Nes_Mapped_File::close()
+{
+	#ifdef NES_MAPPED_FILES
+		if ( map )
+			munmap( map, size_ );
+	#endif
+	map = 0;
+	
+	delete (Std_File_Reader*) file;
+	file = 0;
+	
+	free( buf );
+	buf = 0;
+	buf_size = 0;
+	size_ = 0;
+}
+
+blargg_err_t Nes_Mapped_File::open( const char* path )
+{
+	close();
+	
+	#ifdef NES_MAPPED_FILES
+		int fd = ::open( path, O_RDONLY );
+		if ( fd < 0 )
+			return "Couldn't open file";
+		
+		struct stat st;
+		if ( !fstat( fd, &st ) && st.st_size > 0 && (long) st.st_size == st.st_size )
+		{
+			void* p = mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+			if ( p != MAP_FAILED )
+			{
+				map = p;
+				size_ = st.st_size;
+			}
+		}
+		::close( fd ); // mapping keeps file open
+		if ( map )
+			return 0;
+		// fall back to reading
+	#endif
+	
+	Std_File_Reader* in = BLARGG_NEW Std_File_Reader;
+	CHECK_ALLOC( in );
+	file = in;
+	RETURN_ERR( in->open( path ) );
+	size_ = (long) in->size();
+	return 0;
+}
+
+blargg_err_t Nes_Mapped_File::data( long offset, long size, unsigned char const** out )
+{
+	*out = 0;
+	if ( offset < 0 || size < 0 || size > size_ - offset )
+		return "Tried to read past end of file";
+	
+	if ( map )
+	{
+		*out = (unsigned char const*) map + offset;
+		return 0;
+	}
+	
+	require( file );
+	if ( size > buf_size )
+	{
+		void* p = realloc( buf, size );
+		CHECK_ALLOC( p );
+		buf = (unsigned char*) p;
+		buf_size = size;
+	}
+	Std_File_Reader* in = (Std_File_Reader*) file;
+	RETURN_ERR( in->seek( offset ) );
+	RETURN_ERR( in->read( buf, size ) );
+	*out = buf;
+	return 0;
+}
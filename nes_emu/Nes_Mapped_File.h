@@ -0,0 +1,45 @@
+
+// Read-only file access that only reads the parts that are used
+
+// Nes_Emu 0.7.0
+
+#ifndef NES_MAPPED_FILE_H
+#define NES_MAPPED_FILE_H
+
+#include "blargg_common.h"
+
+// Gives access to ranges of a file without reading all of it first. If compiled
+// with NES_MAPPED_FILES defined, the file is memory-mapped (POSIX only), so pages
+// are read on first touch and can be dropped again by the OS when memory is low.
+// Otherwise each range is read into a buffer when requested.
+class Nes_Mapped_File {
+public:
+	Nes_Mapped_File();
+	~Nes_Mapped_File();
+	
+	// Open file, closing any already open
+	blargg_err_t open( const char* path );
+	
+	// Close file. Pointers returned by data() become invalid.
+	void close();
+	
+	// Size of file, in bytes
+	long size() const { return size_; }
+	
+	// Get pointer to 'size' bytes at 'offset' in file. Pointer remains valid
+	// until next call to data() or close().
+	blargg_err_t data( long offset, long size, unsigned char const** out );
+
+private:
+	// noncopyable
+	Nes_Mapped_File( const Nes_Mapped_File& );
+	Nes_Mapped_File& operator = ( const Nes_Mapped_File& );
+	
+	long size_;
+	void* map;      // memory-mapped file
+	void* file;     // file read from when not mapped
+	unsigned char* buf;
+	long buf_size;
+};
+
+#endif
@@ -65,6 +65,7 @@ void mapper_state_t::write( const void* p, unsigned long s )
 	require( s <= max_mapper_state_size );
 	require( !size );
 	size = s;
+	sound_offset = s;
 	memcpy( data, p, s );
 }
 
@@ -29,7 +29,6 @@ Nes_Namco_Apu::~Nes_Namco_Apu()
 
 void Nes_Namco_Apu::reset()
 {
-	last_time = 0;
 	addr_reg = 0;
 	
 	int i;
@@ -42,6 +41,7 @@ void Nes_Namco_Apu::reset()
 		osc.delay = 0;
 		osc.last_amp = 0;
 		osc.wave_pos = 0;
+		osc.last_time = 0;
 	}
 }
 
@@ -71,79 +71,124 @@ void Nes_Namco_Apu::reflect_state( Tagged_Data& data )
 
 void Nes_Namco_Apu::end_frame( nes_time_t time )
 {
-	if ( time > last_time )
-		run_until( time );
+	run_until( time );
 	
-	assert( last_time >= time );
-	last_time -= time;
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		assert( oscs [i].last_time >= time );
+		oscs [i].last_time -= time;
+	}
 }
 
-void Nes_Namco_Apu::run_until( nes_time_t nes_end_time )
+// True if register write to addr affects output of oscillator
+inline bool Nes_Namco_Apu::osc_uses( int i, int addr ) const
 {
+	if ( (addr >> 3) == (0x40 >> 3) + i )
+		return true;
+	
+	// wave samples are nibbles anywhere in register memory (position can be past
+	// end of wave if its size was just reduced)
+	const BOOST::uint8_t* osc_reg = &reg [i * 8 + 0x40];
+	int wave_size = 32 - (osc_reg [4] >> 2 & 7) * 4;
+	if ( wave_size <= oscs [i].wave_pos )
+		wave_size = oscs [i].wave_pos + 1;
+	return (osc_reg [6] >> 1) <= addr && addr <= ((osc_reg [6] + wave_size - 1) >> 1);
+}
+
+void Nes_Namco_Apu::write_data( nes_time_t time, int data )
+{
+	// Only run oscillators that the write affects. The others are left behind and
+	// later generate their unchanged waveform in one longer run, which gives
+	// identical output but avoids restarting all eight for every register write.
+	int addr = addr_reg & 0x7F;
+	if ( addr == 0x7F )
+	{
+		run_until( time ); // number of active oscillators
+	}
+	else
+	{
+		for ( int i = 0; i < osc_count; i++ )
+			if ( osc_uses( i, addr ) )
+				run_osc( i, time );
+	}
+	access() = data;
+}
+
+void Nes_Namco_Apu::run_until( nes_time_t time )
+{
+	for ( int i = 0; i < osc_count; i++ )
+		if ( oscs [i].last_time < time )
+			run_osc( i, time );
+}
+
+void Nes_Namco_Apu::run_osc( int i, nes_time_t nes_end_time )
+{
+	Namco_Osc& osc = oscs [i];
+	require( nes_end_time >= osc.last_time );
+	nes_time_t last_time = osc.last_time;
+	osc.last_time = nes_end_time;
+	
 	int active_oscs = (reg [0x7F] >> 4 & 7) + 1;
-	for ( int i = osc_count - active_oscs; i < osc_count; i++ )
+	if ( i < osc_count - active_oscs )
+		return;
+	
+	Blip_Buffer* output = osc.output;
+	if ( !output )
+		return;
+	
+	blip_resampled_time_t time =
+			output->resampled_time( last_time ) + osc.delay;
+	blip_resampled_time_t end_time = output->resampled_time( nes_end_time );
+	osc.delay = 0;
+	if ( time < end_time )
 	{
-		Namco_Osc& osc = oscs [i];
-		Blip_Buffer* output = osc.output;
-		if ( !output )
-			continue;
+		const BOOST::uint8_t* osc_reg = &reg [i * 8 + 0x40];
+		if ( !(osc_reg [4] & 0xE0) )
+			return;
 		
-		blip_resampled_time_t time =
-				output->resampled_time( last_time ) + osc.delay;
-		blip_resampled_time_t end_time = output->resampled_time( nes_end_time );
-		osc.delay = 0;
-		if ( time < end_time )
+		int volume = osc_reg [7] & 15;
+		if ( !volume )
+			return;
+		
+		long freq = (osc_reg [4] & 3) * 0x10000 + osc_reg [2] * 0x100L + osc_reg [0];
+		if ( freq < 64 * active_oscs )
+			return; // prevent low frequencies from excessively delaying freq changes
+		blip_resampled_time_t period =
+				output->resampled_duration( 983040 ) / freq * active_oscs;
+		
+		int wave_size = 32 - (osc_reg [4] >> 2 & 7) * 4;
+		if ( !wave_size )
+			return;
+		
+		int last_amp = osc.last_amp;
+		int wave_pos = osc.wave_pos;
+		
+		do
 		{
-			const BOOST::uint8_t* osc_reg = &reg [i * 8 + 0x40];
-			if ( !(osc_reg [4] & 0xE0) )
-				continue;
-			
-			int volume = osc_reg [7] & 15;
-			if ( !volume )
-				continue;
-			
-			long freq = (osc_reg [4] & 3) * 0x10000 + osc_reg [2] * 0x100L + osc_reg [0];
-			if ( freq < 64 * active_oscs )
-				continue; // prevent low frequencies from excessively delaying freq changes
-			blip_resampled_time_t period =
-					output->resampled_duration( 983040 ) / freq * active_oscs;
+			// read wave sample
+			int addr = wave_pos + osc_reg [6];
+			int sample = reg [addr >> 1] >> (addr << 2 & 4);
+			wave_pos++;
+			sample = (sample & 15) * volume;
 			
-			int wave_size = 32 - (osc_reg [4] >> 2 & 7) * 4;
-			if ( !wave_size )
-				continue;
-			
-			int last_amp = osc.last_amp;
-			int wave_pos = osc.wave_pos;
-			
-			do
+			// output impulse if amplitude changed
+			int delta = sample - last_amp;
+			if ( delta )
 			{
-				// read wave sample
-				int addr = wave_pos + osc_reg [6];
-				int sample = reg [addr >> 1] >> (addr << 2 & 4);
-				wave_pos++;
-				sample = (sample & 15) * volume;
-				
-				// output impulse if amplitude changed
-				int delta = sample - last_amp;
-				if ( delta )
-				{
-					last_amp = sample;
-					synth.offset_resampled( time, delta, output );
-				}
-				
-				// next sample
-				time += period;
-				if ( wave_pos >= wave_size )
-					wave_pos = 0;
+				last_amp = sample;
+				synth.offset_resampled( time, delta, output );
 			}
-			while ( time < end_time );
 			
-			osc.wave_pos = wave_pos;
-			osc.last_amp = last_amp;
+			// next sample
+			time += period;
+			if ( wave_pos >= wave_size )
+				wave_pos = 0;
 		}
-		osc.delay = time - end_time;
+		while ( time < end_time );
+		
+		osc.wave_pos = wave_pos;
+		osc.last_amp = last_amp;
 	}
-	
-	last_time = nes_end_time;
+	osc.delay = time - end_time;
 }
 
@@ -47,11 +47,11 @@ private:
 		Blip_Buffer* output;
 		short last_amp;
 		short wave_pos;
+		nes_time_t last_time; // each oscillator is only run when necessary
 	};
 	
 	Namco_Osc oscs [osc_count];
 	
-	nes_time_t last_time;
 	int addr_reg;
 	
 	enum { reg_count = 0x80 };
@@ -59,6 +59,8 @@ private:
 	Blip_Synth<blip_good_quality,15> synth;
 	
 	BOOST::uint8_t& access();
+	bool osc_uses( int osc, int addr ) const;
+	void run_osc( int osc, nes_time_t );
 	void run_until( nes_time_t );
 };
 /*
@@ -94,11 +96,5 @@ inline void Nes_Namco_Apu::osc_output( int i, Blip_Buffer* buf )
 	oscs [i].output = buf;
 }
 
-inline void Nes_Namco_Apu::write_data( nes_time_t time, int data )
-{
-	run_until( time );
-	access() = data;
-}
-
 #endif
 
@@ -97,7 +97,8 @@ inline nes_time_t Nes_Square::maintain_phase( nes_time_t time, nes_time_t end_ti
 	return time;
 }
 
-void Nes_Square::run( nes_time_t time, nes_time_t end_time )
+template<class Synth>
+void Nes_Square::run( Synth const& synth, nes_time_t time, nes_time_t end_time )
 {
 	const int period = this->period();
 	const int timer_period = (period + 1) * 2;
@@ -144,7 +145,6 @@ void Nes_Square::run( nes_time_t time, nes_time_t end_time )
 		if ( time < end_time )
 		{
 			Blip_Buffer* const output = this->output;
-			const Synth& synth = this->synth;
 			int delta = amp * 2 - volume;
 			int phase = this->phase;
 			
@@ -202,7 +202,8 @@ inline nes_time_t Nes_Triangle::maintain_phase( nes_time_t time, nes_time_t end_
 	return time;
 }
 
-void Nes_Triangle::run( nes_time_t time, nes_time_t end_time )
+template<class Synth>
+void Nes_Triangle::run( Synth const& synth, nes_time_t time, nes_time_t end_time )
 {
 	const int timer_period = period() + 1;
 	if ( !output )
@@ -394,7 +395,8 @@ void Nes_Dmc::fill_buffer()
 	}
 }
 
-void Nes_Dmc::run( nes_time_t time, nes_time_t end_time )
+template<class Synth>
+void Nes_Dmc::run( Synth const& synth, nes_time_t time, nes_time_t end_time )
 {
 	int delta = update_amp( dac );
 	if ( !output )
@@ -467,7 +469,8 @@ static const short noise_period_table [16] = {
 	0x0CA, 0x0FE, 0x17C, 0x1FC, 0x2FA, 0x3F8, 0x7F2, 0xFE4
 };
 
-void Nes_Noise::run( nes_time_t time, nes_time_t end_time )
+template<class Synth>
+void Nes_Noise::run( Synth const& synth, nes_time_t time, nes_time_t end_time )
 {
 	int period = noise_period_table [regs [2] & 15];
 	#if NES_APU_NOISE_LOW_CPU
@@ -543,3 +546,18 @@ void Nes_Noise::run( nes_time_t time, nes_time_t end_time )
 	delay = time - end_time;
 }
 
+// Instantiate for the synthesizer qualities used by Nes_Apu's quality tiers
+
+#define INSTANTIATE_RUN( osc, quality ) \
+	template void osc::run( Blip_Synth<quality,1> const&, nes_time_t, nes_time_t );
+
+INSTANTIATE_RUN( Nes_Square,   blip_med_quality )
+INSTANTIATE_RUN( Nes_Square,   blip_good_quality )
+INSTANTIATE_RUN( Nes_Square,   blip_high_quality )
+INSTANTIATE_RUN( Nes_Triangle, blip_med_quality )
+INSTANTIATE_RUN( Nes_Triangle, blip_high_quality )
+INSTANTIATE_RUN( Nes_Noise,    blip_med_quality )
+INSTANTIATE_RUN( Nes_Noise,    blip_high_quality )
+INSTANTIATE_RUN( Nes_Dmc,      blip_med_quality )
+INSTANTIATE_RUN( Nes_Dmc,      blip_high_quality )
+
@@ -58,13 +58,9 @@ struct Nes_Square : Nes_Envelope
 	int phase;
 	int sweep_delay;
 	
-	typedef Blip_Synth<blip_good_quality,1> Synth;
-	Synth const& synth; // shared between squares
-	
-	Nes_Square( Synth const* s ) : synth( *s ) { }
-	
 	void clock_sweep( int adjust );
-	void run( nes_time_t, nes_time_t );
+	template<class Synth>
+	void run( Synth const&, nes_time_t, nes_time_t );
 	void reset() {
 		sweep_delay = 0;
 		Nes_Envelope::reset();
@@ -79,10 +75,10 @@ struct Nes_Triangle : Nes_Osc
 	enum { phase_range = 16 };
 	int phase;
 	int linear_counter;
-	Blip_Synth<blip_med_quality,1> synth;
 	
 	int calc_amp() const;
-	void run( nes_time_t, nes_time_t );
+	template<class Synth>
+	void run( Synth const&, nes_time_t, nes_time_t );
 	void clock_linear_counter();
 	void reset() {
 		linear_counter = 0;
@@ -97,9 +93,9 @@ struct Nes_Triangle : Nes_Osc
 struct Nes_Noise : Nes_Envelope
 {
 	int noise;
-	Blip_Synth<blip_med_quality,1> synth;
 	
-	void run( nes_time_t, nes_time_t );
+	template<class Synth>
+	void run( Synth const&, nes_time_t, nes_time_t );
 	void reset() {
 		noise = 1 << 14;
 		Nes_Envelope::reset();
@@ -133,11 +129,10 @@ struct Nes_Dmc : Nes_Osc
 	
 	Nes_Apu* apu;
 	
-	Blip_Synth<blip_med_quality,1> synth;
-	
 	void start();
 	void write_register( int, int );
-	void run( nes_time_t, nes_time_t );
+	template<class Synth>
+	void run( Synth const&, nes_time_t, nes_time_t );
 	void recalc_irq();
 	void fill_buffer();
 	void reload_sample();
@@ -146,5 +141,16 @@ struct Nes_Dmc : Nes_Osc
 	nes_time_t next_read_time() const;
 };
 
+// Synthesizers for one quality tier. Wider impulses alias less but take longer
+// to add for each amplitude transition.
+template<int square_quality,int tnd_quality>
+struct Nes_Osc_Synths
+{
+	Blip_Synth<square_quality,1> square; // shared between squares
+	Blip_Synth<tnd_quality,1> triangle;
+	Blip_Synth<tnd_quality,1> noise;
+	Blip_Synth<tnd_quality,1> dmc;
+};
+
 #endif
 
@@ -382,6 +382,7 @@ void Nes_Ppu::dma_sprites( nes_time_t time, void const* in )
 	render_until( time );
 	
 	invalidate_sprite_max( time );
+	invalidate_sprite_lists();
 	// catch anything trying to dma while rendering is enabled
 	check( time + 513 <= vbl_end_time || !(w2001 & 0x18) );
 	
@@ -492,7 +493,10 @@ void Nes_Ppu::write( nes_time_t time, unsigned addr, int data )
 			vram_temp = (vram_temp & ~0x0C00) | ((data & 3) * 0x400);
 			
 			if ( changed & 0x20 ) // sprite height changed
+			{
 				invalidate_sprite_max( time );
+				invalidate_sprite_lists();
+			}
 			w2000 = data;
 			addr_inc = data & 4 ? 32 : 1;
 
@@ -506,6 +510,7 @@ void Nes_Ppu::write( nes_time_t time, unsigned addr, int data )
 			{
 				render_until( time + 1 ); // emphasis/monochrome bits changed
 				palette_changed = 0x18;
+				palette_generation++;
 			}
 			
 			if ( changed & 0x14 )
@@ -539,6 +544,8 @@ void Nes_Ppu::write( nes_time_t time, unsigned addr, int data )
 				render_until( time );
 				invalidate_sprite_max( time );
 			}
+			if ( !(w2003 & 3) ) // Y coordinate
+				invalidate_sprite_lists();
 			spr_ram [w2003] = data;
 			w2003 = (w2003 + 1) & 0xff;
 			break;
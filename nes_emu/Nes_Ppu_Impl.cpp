@@ -31,6 +31,9 @@ Nes_Ppu_Impl::Nes_Ppu_Impl()
 	tile_cache = NULL;
 	host_palette = NULL;
 	max_palette_size = 0;
+	palette_generation = 0;
+	captured_generation = 0;
+	sprite_lists_valid = false;
 	tile_cache_mem = NULL;
 	ppu_state_t::unused = 0;
 	
@@ -161,9 +164,11 @@ void Nes_Ppu_Impl::load_state( Nes_State_ const& in )
 	
 	if ( in.ppu_valid )
 		STATIC_CAST(ppu_state_t&,*this) = *in.ppu;
+	palette_generation++;
 	
 	if ( in.spr_ram_valid )
 		memcpy( spr_ram, in.spr_ram, sizeof spr_ram );
+	invalidate_sprite_lists();
 	
 	assert( in.nametable_size <= (int) sizeof impl->nt_ram );
 	if ( in.nametable_size >= 0x800 )
@@ -208,10 +213,12 @@ void Nes_Ppu_Impl::reset( bool full_reset )
 		memset( impl->nt_ram, 0xff, sizeof impl->nt_ram );
 		memcpy( palette, initial_palette, sizeof palette );
 	}
+	palette_generation++;
 	
 	set_nt_banks( 0, 0, 0, 0 );
 	set_chr_bank( 0, chr_addr_size, 0 );
 	memset( spr_ram, 0xff, sizeof spr_ram );
+	invalidate_sprite_lists();
 	all_tiles_modified();
 	if ( max_palette_size > 0 )
 		memset( host_palette, 0, max_palette_size * sizeof *host_palette );
@@ -222,6 +229,7 @@ void Nes_Ppu_Impl::capture_palette()
 	if ( palette_size + palette_increment <= max_palette_size )
 	{
 		palette_offset = (palette_begin + palette_size) * 0x01010101;
+		captured_generation = palette_generation;
 		
 		short* out = host_palette + palette_size;
 		palette_size += palette_increment;
@@ -358,124 +366,64 @@ void Nes_Ppu_Impl::update_tiles( int first_tile )
 
 // Sprite max
 
-template<int height>
-struct calc_sprite_max_scanlines
+void Nes_Ppu_Impl::build_sprite_lists()
 {
-	static unsigned long func( byte const* sprites, byte* scanlines, int begin )
+	sprite_lists_valid = true;
+	memset( sprite_masks, 0, sizeof sprite_masks );
+	memset( sprite_counts, 0, sizeof sprite_counts );
+	
+	int const height = sprite_height();
+	for ( int n = 0; n < 64; n++ )
 	{
-		typedef BOOST::uint32_t uint32_t;
-		
-		unsigned long any_hits = 0;
-		unsigned long const offset = 0x01010101 + zero;
-		unsigned limit = 239 + height - begin;
-		for ( int n = 64; n; --n )
+		int scanline = spr_ram [n * 4];
+		int end = min( scanline + height, (int) last_sprite_max_scanline );
+		uint32_t const bit = (uint32_t) 1 << (n & 31);
+		for ( ; scanline < end; scanline++ )
 		{
-			int top = *sprites;
-			sprites += 4;
-			byte* p = scanlines + top;
-			if ( (unsigned) (239 - top) < limit )
-			{
-				unsigned long p0 = (uint32_t&) p [0] + offset;
-				unsigned long p4 = (uint32_t&) p [4] + offset;
-				(uint32_t&) p [0] = p0;
-				any_hits |= p0;
-				(uint32_t&) p [4] = p4;
-				any_hits |= p4;
-				if ( height > 8 )
-				{
-					unsigned long p0 = (uint32_t&) p [ 8] + offset;
-					unsigned long p4 = (uint32_t&) p [12] + offset;
-					(uint32_t&) p [ 8] = p0;
-					any_hits |= p0;
-					(uint32_t&) p [12] = p4;
-					any_hits |= p4;
-				}
-			}
+			sprite_masks [scanline] [n >> 5] |= bit;
+			sprite_counts [scanline]++;
 		}
-		
-		return any_hits;
 	}
-};
+}
 
 long Nes_Ppu_Impl::recalc_sprite_max( int scanline )
 {
-	int const max_scanline_count = image_height;
-	
-	byte sprite_max_scanlines [256 + 16];
-	
-	// recalculate sprites per scanline
-	memset( sprite_max_scanlines + scanline, 0x78, last_sprite_max_scanline - scanline );
-	unsigned long any_hits;
-	if ( w2000 & 0x20 )
-		any_hits = calc_sprite_max_scanlines<16>::func( spr_ram, sprite_max_scanlines, scanline );
-	else
-		any_hits = calc_sprite_max_scanlines<8 >::func( spr_ram, sprite_max_scanlines, scanline );
+	update_sprite_lists();
 	
-	// cause search to terminate past max_scanline_count if none have 8 or more sprites
-	(uint32_t&) sprite_max_scanlines [max_scanline_count] = 0;
-	sprite_max_scanlines [max_scanline_count + 3] = 0x80;
-	
-	// avoid scan if no possible hits
-	if ( !(any_hits & 0x80808080) )
-		return 0;
+	int const height = sprite_height();
 	
 	// find soonest scanline with 8 or more sprites
-	while ( true )
+	for ( ; scanline < last_sprite_max_scanline; scanline++ )
 	{
-		unsigned long const mask = 0x80808080 + zero;
-		
-		// check four at a time
-		byte* pos = &sprite_max_scanlines [scanline];
-		unsigned long n = (uint32_t&) *pos;
-		while ( 1 )
-		{
-			unsigned long x = n & mask;
-			pos += 4;
-			n = (uint32_t&) *pos;
-			if ( x )
-				break;
-		}
+		if ( sprite_counts [scanline] < 8 )
+			continue;
 		
-		int height = sprite_height();
+		// find time that max sprites flag is set (or that it won't be set)
+		uint32_t const* mask = sprite_masks [scanline];
 		int remain = 8;
 		int i = 0;
-		
-		// find which of the four
-		pos -= 3 + (pos [-4] >> 7 & 1);
-		pos += 1 - (*pos >> 7 & 1);
-		pos += 1 - (*pos >> 7 & 1);
-		assert( *pos & 0x80 );
-		
-		scanline = pos - sprite_max_scanlines;
-		if ( scanline >= max_scanline_count )
-			break;
-		
-		// find time that max sprites flag is set (or that it won't be set)
 		do
 		{
-			int relative = scanline - spr_ram [i];
+			int n = i >> 2;
+			i += 4;
+			remain -= mask [n >> 5] >> (n & 31) & 1;
+		}
+		while ( remain );
+		
+		// now use screwey search for 9th sprite
+		int offset = 0;
+		while ( i < 0x100 )
+		{
+			int relative = scanline - spr_ram [i + offset];
+			//dprintf( "Checking sprite %d [%d]\n", i / 4, offset );
 			i += 4;
-			if ( (unsigned) relative < (unsigned) height && !--remain )
+			offset = (offset + 1) & 3;
+			if ( (unsigned) relative < (unsigned) height )
 			{
-				// now use screwey search for 9th sprite
-				int offset = 0;
-				while ( i < 0x100 )
-				{
-					int relative = scanline - spr_ram [i + offset];
-					//dprintf( "Checking sprite %d [%d]\n", i / 4, offset );
-					i += 4;
-					offset = (offset + 1) & 3;
-					if ( (unsigned) relative < (unsigned) height )
-					{
-						//dprintf( "sprite max on scanline %d\n", scanline );
-						return scanline * scanline_len + (unsigned) i / 2;
-					}
-				}
-				break;
+				//dprintf( "sprite max on scanline %d\n", scanline );
+				return scanline * scanline_len + (unsigned) i / 2;
 			}
 		}
-		while ( i < 0x100 );
-		scanline++;
 	}
 	
 	return 0;
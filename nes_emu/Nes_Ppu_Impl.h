@@ -41,6 +41,10 @@ public:
 	int max_palette_size;
 	int palette_size; // set after frame is rendered
 	
+	// Incremented whenever palette entries or emphasis/monochrome bits change
+	unsigned long palette_generation;
+	unsigned long captured_generation; // palette_generation of last captured palette
+	
 	// Mapping
 	enum { vaddr_clock_mask = 0x1000 };
 	void set_nt_banks( int bank0, int bank1, int bank2, int bank3 );
@@ -60,6 +64,10 @@ public:
 			BOOST::uint32_t clip_buf [256 * 2];
 			byte mini_offscreen [buffer_width * mini_offscreen_height];
 		};
+		
+		// copy of last image and host palette, for change detection
+		byte prev_image [image_height] [image_width];
+		short prev_palette [256];
 	};
 	impl_t* impl;
 	enum { scanline_len = 341 };
@@ -77,6 +85,16 @@ protected: //friend class Nes_Ppu; private:
 	
 	enum { last_sprite_max_scanline = 240 };
 	long recalc_sprite_max( int scanline );
+	
+	// Sprites in range of each scanline (Y coordinate within sprite_height() - 1
+	// lines above or on it) as OAM index bit masks, and number of them. Rebuilt
+	// only after sprite RAM or sprite height changes.
+	uint32_t sprite_masks [last_sprite_max_scanline] [2];
+	byte sprite_counts [last_sprite_max_scanline];
+	bool sprite_lists_valid;
+	void invalidate_sprite_lists() { sprite_lists_valid = false; }
+	void update_sprite_lists() { if ( !sprite_lists_valid ) build_sprite_lists(); }
+	void build_sprite_lists();
 	int first_opaque_sprite_line() const;
 	
 protected: //friend class Nes_Ppu_Rendering; private:
@@ -180,7 +198,10 @@ inline int Nes_Ppu_Impl::write_2007( int data )
 		int changed = entry ^ data;
 		entry = data;
 		if ( changed )
+		{
 			palette_changed = 0x18;
+			palette_generation++;
+		}
 	}
 	
 	return changed;
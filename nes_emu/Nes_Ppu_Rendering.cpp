@@ -219,6 +219,17 @@ void Nes_Ppu_Rendering::draw_sprites_( int begin, int end )
 {
 	// Draws sprites on scanlines begin through end - 1. Handles clipping.
 	
+	// only visit sprites in range of at least one of the scanlines
+	update_sprite_lists();
+	uint32_t in_range [2] = { 0, 0 };
+	for ( int n = max( begin - 1, 0 ); n < end - 1; n++ )
+	{
+		in_range [0] |= sprite_masks [n] [0];
+		in_range [1] |= sprite_masks [n] [1];
+	}
+	if ( !(in_range [0] | in_range [1]) )
+		return;
+	
 	int const sprite_height = this->sprite_height();
 	int end_minus_one = end - 1;
 	int begin_minus_one = begin - 1;
@@ -226,7 +237,10 @@ void Nes_Ppu_Rendering::draw_sprites_( int begin, int end )
 	do
 	{
 		byte const* sprite = &spr_ram [index];
+		int n = index >> 2;
 		index += 4;
+		if ( !(in_range [n >> 5] >> (n & 31) & 1) )
+			continue;
 		
 		// find if sprite is visible
 		int top_minus_one = sprite [0];
@@ -485,3 +499,46 @@ void Nes_Ppu_Rendering::draw_background( int start, int count )
 	}
 }
 
+// Change detection
+
+void Nes_Ppu_Rendering::compare_rows( int start, int count )
+{
+	if ( start != compared_rows )
+		return; // compare_image() compares whatever is left
+	compared_rows = start + count;
+	
+	byte const* in = host_pixels + host_row_bytes * start + image_left;
+	for ( int y = start; y < start + count; y++ )
+	{
+		byte* prev = impl->prev_image [y];
+		if ( memcmp( prev, in, image_width ) )
+		{
+			memcpy( prev, in, image_width );
+			changed_rows [y >> 5] |= (uint32_t) 1 << (y & 31);
+			changed_count++;
+		}
+		in += host_row_bytes;
+	}
+}
+
+int Nes_Ppu_Rendering::compare_image( uint32_t* changed )
+{
+	assert( host_pixels );
+	
+	// scanlines that weren't rendered this frame
+	compare_rows( compared_rows, image_height - compared_rows );
+	
+	// host palette change affects every scanline
+	if ( !prev_image_valid || palette_size != prev_palette_size ||
+			memcmp( impl->prev_palette, host_palette, palette_size * sizeof *host_palette ) )
+	{
+		prev_image_valid = true;
+		prev_palette_size = palette_size;
+		memcpy( impl->prev_palette, host_palette, palette_size * sizeof *host_palette );
+		memset( changed_rows, ~0, sizeof changed_rows );
+		changed_count = image_height;
+	}
+	
+	memcpy( changed, changed_rows, sizeof changed_rows );
+	return changed_count;
+}
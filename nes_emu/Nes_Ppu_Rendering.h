@@ -7,6 +7,7 @@
 #define NES_PPU_RENDERING_H
 
 #include "Nes_Ppu_Impl.h"
+#include <string.h>
 
 class Nes_Ppu_Rendering : public Nes_Ppu_Impl {
 	typedef Nes_Ppu_Impl base;
@@ -18,9 +19,19 @@ public:
 	byte* host_pixels;
 	long host_row_bytes;
 	
+	// Compare image just rendered to host_pixels with the previous one compared and
+	// set bit (y & 31) of changed [y >> 5] for each scanline y that differs. Any
+	// change to the host palette marks all scanlines. Returns number changed.
+	// Scanlines are compared as they finish rendering, while still in cache.
+	int compare_image( uint32_t* changed );
+	
+	// Cause next compare_image() to mark all scanlines as changed
+	void invalidate_image() { prev_image_valid = false; }
+	
 protected:
 	
 	long sprite_hit_found; // -1: sprite 0 didn't hit, 0: no hit so far, > 0: y * 341 + x
+	void begin_frame();
 	void draw_background( int start, int count );
 	void draw_sprites( int start, int count );
 	
@@ -29,6 +40,14 @@ private:
 	void draw_scanlines( int start, int count, byte* pixels, long pitch, int mode );
 	void draw_background_( int count );
 	
+	// change detection
+	bool prev_image_valid;
+	int prev_palette_size;
+	int compared_rows; // scanlines of current frame compared so far
+	int changed_count;
+	uint32_t changed_rows [(image_height + 31) / 32];
+	void compare_rows( int start, int count );
+	
 	// destination for draw functions; avoids extra parameters
 	byte* scanline_pixels; 
 	long scanline_row_bytes;
@@ -51,12 +70,26 @@ inline Nes_Ppu_Rendering::Nes_Ppu_Rendering()
 {
 	sprite_limit = 8;
 	host_pixels = NULL;
+	prev_image_valid = false;
+	prev_palette_size = 0;
+	compared_rows = 0;
+	changed_count = 0;
+	memset( changed_rows, 0, sizeof changed_rows );
+}
+
+inline void Nes_Ppu_Rendering::begin_frame()
+{
+	compared_rows = 0;
+	changed_count = 0;
+	memset( changed_rows, 0, sizeof changed_rows );
+	base::begin_frame();
 }
 
 inline void Nes_Ppu_Rendering::draw_sprites( int start, int count )
 {
 	assert( host_pixels );
 	draw_scanlines( start, count, host_pixels + host_row_bytes * start, host_row_bytes, 2 );
+	compare_rows( start, count ); // sprites are drawn last, so scanlines are final
 }
 
 #endif
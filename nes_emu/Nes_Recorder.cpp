@@ -3,7 +3,9 @@
 
 #include "Nes_Recorder.h"
 
+#include <stdio.h>
 #include <string.h>
+#include "Nes_Worker.h"
 
 /* Copyright (C) 2004-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -20,49 +22,107 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
 
 int const joypad_sync_value = 0xFF; // joypad data on frames it's never read
 
+struct Nes_Recorder::index_job_t
+{
+	Nes_Recorder emu;
+	Nes_Film film;          // joypad data of segment and snapshot at its beginning
+	frame_count_t begin;
+	frame_count_t end;
+};
+
+struct Nes_Recorder::index_bg_t
+{
+	index_job_t job;
+	frame_count_t time;     // beginning of next segment
+	Nes_Worker worker;      // destroyed first, so it waits for job to finish
+};
+
 Nes_Recorder::Nes_Recorder()
 {
-	cache = 0;
 	film_ = 0;
+	pack_in_background = true;
+	cache.set_worker( &worker );
+	index_bg = 0;
+	index_error = 0;
+	rewind_budget = 0;
+	rewind_spacing = 0;
 	frames = 0;
+	pack_buf = 0;
 	resync_enabled = false;
 	disable_reverse( 1 ); // sets cache_period_ and cache_size
 	reverse_allowed = true;
-	buffer_height_ = Nes_Ppu::buffer_height * frames_size + 2;
+	memset( &render_frame, 0, sizeof render_frame );
+	render_frame.top = 1;
 }
 
 Nes_Recorder::~Nes_Recorder()
 {
-	free( frames );
-	delete [] cache;
+	end_index();
+	if ( film_ )
+		film_->set_worker( 0 );
+	if ( frames )
+	{
+		for ( int i = 0; i < frames_size; i++ )
+			free( frames [i].data );
+		free( frames );
+	}
+	free( pack_buf );
 }
 
 blargg_err_t Nes_Recorder::init_()
 {
 	RETURN_ERR( base::init_() );
 	
-	cache = new Nes_State [cache_size];
+	if ( pack_in_background && !worker.thread_count() && worker.start( 1 ) )
+		check( false ); // blocks are packed on calling thread instead
+	
+	if ( rewind_budget )
+	{
+		// every frame for a second, every spacing frames for a minute, then sparser
+		int const count = 60 * frame_rate / rewind_spacing;
+		frame_count_t spacing = 1;
+		RETURN_ERR( cache.add_tier( spacing, frame_rate ) );
+		for ( int n = 3; n--; )
+			RETURN_ERR( cache.add_tier( spacing *= rewind_spacing, count ) );
+		cache.set_budget( rewind_budget );
+	}
+	else
+	{
+		RETURN_ERR( cache.add_tier( cache_period_, cache_size ) );
+	}
 	
-	int frame_count = reverse_allowed ? frames_size : 1;
-	CHECK_ALLOC( frames = (saved_frame_t*) calloc( sizeof *frames, frame_count ) );
-	for ( int i = 0; i < frame_count; i++ )
-		frames [i].top = (long) i * Nes_Ppu::buffer_height + 1;
+	if ( reverse_allowed )
+	{
+		CHECK_ALLOC( frames = (saved_frame_t*) calloc( sizeof *frames, frames_size ) );
+		CHECK_ALLOC( pack_buf = (byte*) malloc( max_packed_frame ) );
+	}
 	
 	return 0;
 }
 
+void Nes_Recorder::set_rewind( long budget, int spacing )
+{
+	require( budget > 0 && spacing > 1 );
+	rewind_budget = budget;
+	rewind_spacing = spacing;
+}
+
 void Nes_Recorder::clear_cache()
 {
 	ready_to_resync = false;
 	reverse_enabled = false;
-	for ( int i = 0; i < cache_size; i++ )
-		cache [i].set_timestamp( invalid_frame_count );
+	cache.clear();
 }
 
 void Nes_Recorder::set_film( Nes_Film* new_film, frame_count_t time )
 {
 	require( new_film );
+	end_index();
+	index_error = 0;
+	if ( film_ )
+		film_->set_worker( 0 );
 	film_ = new_film;
+	film_->set_worker( &worker );
 	clear_cache();
 	if ( !film_->blank() )
 	{
@@ -74,6 +134,7 @@ void Nes_Recorder::set_film( Nes_Film* new_film, frame_count_t time )
 
 void Nes_Recorder::reset( bool full_reset, bool erase_battery_ram )
 {
+	end_index();
 	base::reset( full_reset, erase_battery_ram );
 	tell_ = 0;
 	film_->clear();
@@ -88,15 +149,10 @@ void Nes_Recorder::loading_state( Nes_State const& in )
 
 // Frame emulation
 
-inline int Nes_Recorder::cache_index( frame_count_t t ) const
-{
-	return (t / cache_period_) % cache_size;
-}
-
 void Nes_Recorder::emulate_frame_( Nes_Film::joypad_t joypad )
 {
-	if ( base::timestamp() % cache_period_ == 0 )
-		save_state( &cache [cache_index( base::timestamp() )] );
+	if ( Nes_State_* ss = cache.modify( base::timestamp() ) )
+		save_state( ss );
 	
 	if ( base::emulate_frame( joypad & 0xFF, (joypad >> 8) & 0xFF ) ) { }
 }
@@ -109,9 +165,17 @@ void Nes_Recorder::replay_frame_( Nes_Film::joypad_t joypad )
 		{
 			Nes_State_* ss = film_->modify_snapshot( base::timestamp() );
 			if ( ss )
+			{
 				save_state( ss );
+				
+				// playing might get ahead of indexing, so check snapshot here too
+				if ( !index_error )
+					index_error = film_->verify_snapshot( *ss );
+			}
 			else
+			{
 				check( false ); // out of memory simply causes lack of caching
+			}
 		}
 	}
 	
@@ -167,19 +231,17 @@ Nes_State_ const* Nes_Recorder::nearest_snapshot( frame_count_t time ) const
 	if ( ss )
 	{
 		// check cache for any snapshots more recent than film_'s
-		for ( frame_count_t t = time - time % cache_period_;
-				ss->timestamp() < t; t -= cache_period_ )
-		{
-			Nes_State_ const& cache_ss = cache [cache_index( t )];
-			if ( cache_ss.timestamp() == t )
-				return &cache_ss;
-		}
+		Nes_State_ const* cache_ss = cache.nearest( time, ss->timestamp() );
+		if ( cache_ss )
+			return cache_ss;
 	}
 	return ss;
 }
 
 void Nes_Recorder::seek_( frame_count_t time )
 {
+	update_index(); // error is kept for next call
+	
 	Nes_State_ const* ss = nearest_snapshot( time );
 	if ( !film_->contains( time ) || !ss )
 	{
@@ -196,6 +258,7 @@ void Nes_Recorder::seek_( frame_count_t time )
 
 void Nes_Recorder::seek( frame_count_t time )
 {
+	Nes_Latency::timer_t timer( seek_latency_ );
 	check( film_->contains( time ) );
 	time = film_->constrain( time );
 	if ( time != tell() )
@@ -214,7 +277,7 @@ inline frame_count_t Nes_Recorder::advancing_frame()
 		if ( !film_->blank() )
 			seek_( tell_ );
 	}
-	frame_ = &frames [0];
+	frame_ = &render_frame;
 	tell_ = base::timestamp();
 	return tell_++;
 }
@@ -226,6 +289,9 @@ blargg_err_t Nes_Recorder::emulate_frame( int joypad, int joypad2 )
 	
 	Nes_Film::joypad_t joypads = joypad2 * 0x100 + joypad;
 	
+	if ( index_bg && time < index_bg->job.end )
+		end_index(); // being recorded over
+	
 	Nes_State_* ss = 0;
 	RETURN_ERR( film_->record_frame( time, joypads, &ss ) );
 	if ( ss )
@@ -237,8 +303,7 @@ blargg_err_t Nes_Recorder::emulate_frame( int joypad, int joypad2 )
 		RETURN_ERR( film_->set_joypad( time, joypad_sync_value ) );
 	
 	// avoid stale cache snapshot after trimming film
-	if ( base::timestamp() % cache_period_ == 0 )
-		cache [cache_index( base::timestamp() )].set_timestamp( invalid_frame_count );
+	cache.invalidate( base::timestamp() );
 	
 	return 0;
 }
@@ -315,6 +380,19 @@ void Nes_Recorder::next_frame()
 
 // Extra features
 
+blargg_err_t Nes_Recorder::load_branch( Nes_Film_Branch const& branch )
+{
+	end_index();
+	frame_count_t time = tell();
+	frame_count_t same = film_->same_until( branch );
+	blargg_err_t err = film_->load_branch( branch ); // film is blank if this fails
+	if ( !err && time <= same && film_->contains( time ) )
+		cache.invalidate_after( same ); // rest are of recording being replaced
+	else
+		set_film( film_, film_->constrain( time ) );
+	return err;
+}
+
 void Nes_Recorder::record_keyframe()
 {
 	if ( !film_->blank() )
@@ -333,6 +411,227 @@ void Nes_Recorder::record_keyframe()
 	}
 }
 
+// Keyframe indexing
+
+void Nes_Recorder::index_segment( void* data )
+{
+	// replay_frame_() adds a snapshot to film at each multiple of its period
+	index_job_t& job = *(index_job_t*) data;
+	job.emu.set_film( &job.film, job.begin );
+	job.emu.seek_( job.end );
+}
+
+frame_count_t Nes_Recorder::index_interval( frame_count_t interval ) const
+{
+	frame_count_t const period = film_->period();
+	if ( interval < period )
+		interval = period;
+	return interval + (period - interval % period) % period; // film keeps one snapshot per period
+}
+
+// Time of first snapshot in film after time, or end of film if none
+frame_count_t Nes_Recorder::next_snapshot( frame_count_t time ) const
+{
+	frame_count_t const period = film_->period();
+	frame_count_t const end = film_->end();
+	for ( frame_count_t t = time - time % period + period; t < end; t += period )
+	{
+		frame_count_t ss_time = film_->read_snapshot( t ).timestamp();
+		if ( time < ss_time && ss_time < end )
+			return ss_time;
+	}
+	return end;
+}
+
+blargg_err_t Nes_Recorder::init_index_job( index_job_t& job, frame_count_t interval )
+{
+	job.film.clear( interval );
+	job.emu.pack_in_background = false; // packs on index thread instead
+	job.emu.disable_reverse();
+	RETURN_ERR( job.emu.set_sample_rate( 44100 ) ); // also initializes emulator
+	job.emu.set_film( &job.film );
+	return job.emu.set_cart( cart() );
+}
+
+blargg_err_t Nes_Recorder::begin_index_job( index_job_t& job, frame_count_t begin,
+		frame_count_t end, Nes_State_ const& first )
+{
+	// loaded before film is cleared, since first might be in it
+	assert( first.timestamp() == begin );
+	job.emu.base::load_state( first );
+	
+	// film can't be shared with worker thread, so segment is copied
+	job.begin = begin;
+	job.end = end;
+	job.film.clear();
+	for ( frame_count_t t = begin; t < end; t++ )
+	{
+		Nes_State_* ss;
+		RETURN_ERR( job.film.record_frame( t, film_->get_joypad( t ), &ss ) );
+		if ( t == begin )
+		{
+			assert( ss );
+			job.emu.save_state( ss );
+		}
+	}
+	job.film.set_joypad_sync( film_->has_joypad_sync() );
+	return 0;
+}
+
+blargg_err_t Nes_Recorder::end_index_job( index_job_t& job )
+{
+	frame_count_t const interval = job.film.period();
+	for ( frame_count_t t = job.begin - job.begin % interval + interval; t < job.end; t += interval )
+	{
+		Nes_State_ const& ss = job.film.read_snapshot( t );
+		if ( ss.timestamp() == t )
+		{
+			RETURN_ERR( film_->verify_snapshot( ss ) );
+			Nes_State_* out = film_->modify_snapshot( t );
+			CHECK_ALLOC( out );
+			if ( out->timestamp() == invalid_frame_count )
+			{
+				job.emu.base::load_state( ss );
+				job.emu.save_state( out );
+			}
+		}
+	}
+	return 0;
+}
+
+blargg_err_t Nes_Recorder::index_film( int thread_count, frame_count_t interval )
+{
+	require( cart() && !film_->blank() );
+	end_index();
+	interval = index_interval( interval );
+	
+	if ( thread_count > Nes_Worker::max_threads )
+		thread_count = Nes_Worker::max_threads;
+	int const job_count = max( thread_count, 1 );
+	index_job_t* jobs = BLARGG_NEW index_job_t [job_count];
+	CHECK_ALLOC( jobs );
+	
+	blargg_err_t err = 0;
+	for ( int i = 0; i < job_count && !err; i++ )
+		err = init_index_job( jobs [i], interval );
+	if ( !err )
+		err = index_film_( jobs, job_count, thread_count );
+	
+	delete [] jobs;
+	return err;
+}
+
+blargg_err_t Nes_Recorder::index_film_( index_job_t* jobs, int job_count, int thread_count )
+{
+	Nes_Worker worker;
+	RETURN_ERR( worker.start( thread_count ) );
+	
+	frame_count_t const interval = jobs [0].film.period();
+	frame_count_t const end = film_->end();
+	Nes_State_ const* first = film_->nearest_snapshot( film_->begin() );
+	check( first );
+	frame_count_t time = (first ? first->timestamp() : end);
+	while ( time < end )
+	{
+		// replay up to job_count segments at once
+		int count = 0;
+		while ( count < job_count && time < end )
+		{
+			frame_count_t next = next_snapshot( time );
+			if ( time - time % interval + interval < next )
+			{
+				index_job_t& job = jobs [count++];
+				RETURN_ERR( begin_index_job( job, time, next, *film_->nearest_snapshot( time ) ) );
+				worker.add( index_segment, &job );
+			}
+			time = next;
+		}
+		
+		worker.wait();
+		for ( int i = 0; i < count; i++ )
+			RETURN_ERR( end_index_job( jobs [i] ) );
+	}
+	
+	return 0;
+}
+
+blargg_err_t Nes_Recorder::begin_index( frame_count_t interval )
+{
+	require( cart() && !film_->blank() );
+	end_index();
+	index_error = 0;
+	
+	CHECK_ALLOC( index_bg = BLARGG_NEW index_bg_t );
+	blargg_err_t err = init_index_job( index_bg->job, index_interval( interval ) );
+	if ( !err )
+		err = index_bg->worker.start( 1 );
+	if ( !err && !index_bg->worker.thread_count() )
+	{
+		// replaying a segment at every seek would stall playback, so index it all now
+		end_index();
+		index_error = index_film( 1, interval ); // also returned by update_index()
+		return index_error;
+	}
+	
+	Nes_State_ const* first = film_->nearest_snapshot( film_->begin() );
+	check( first );
+	index_bg->time = (first ? first->timestamp() : film_->end());
+	
+	if ( !err )
+		err = continue_index();
+	if ( err )
+		end_index();
+	return err;
+}
+
+// Start replaying next segment that needs snapshots, or end indexing if none
+blargg_err_t Nes_Recorder::continue_index()
+{
+	index_bg_t& bg = *index_bg;
+	index_job_t& job = bg.job;
+	frame_count_t const interval = job.film.period();
+	while ( bg.time < film_->end() )
+	{
+		// segment ends just after next multiple of interval, so it has a snapshot there
+		frame_count_t next = next_snapshot( bg.time );
+		frame_count_t stop = bg.time - bg.time % interval + interval;
+		if ( stop < next )
+		{
+			// start from snapshot in film, or one left in job by previous segment
+			Nes_State_ const* first = film_->nearest_snapshot( bg.time );
+			if ( !first || first->timestamp() != bg.time )
+				first = &job.film.read_snapshot( bg.time );
+			RETURN_ERR( begin_index_job( job, bg.time, stop + 1, *first ) );
+			bg.worker.add( index_segment, &job );
+			bg.time = stop;
+			return 0;
+		}
+		bg.time = next;
+	}
+	
+	end_index();
+	return 0;
+}
+
+blargg_err_t Nes_Recorder::update_index()
+{
+	if ( index_bg && !index_bg->worker.busy() && !index_error )
+	{
+		index_error = end_index_job( index_bg->job );
+		if ( !index_error )
+			index_error = continue_index();
+	}
+	if ( index_error )
+		end_index();
+	return index_error;
+}
+
+void Nes_Recorder::end_index()
+{
+	delete index_bg; // waits for job to finish
+	index_bg = 0;
+}
+
 frame_count_t Nes_Recorder::nearby_keyframe( frame_count_t time ) const
 {
 	// TODO: reimplement using direct snapshot and cache access
@@ -375,6 +674,7 @@ frame_count_t Nes_Recorder::nearby_keyframe( frame_count_t time ) const
 
 void Nes_Recorder::skip( int delta )
 {
+	Nes_Latency::timer_t timer( skip_latency_ );
 	if ( delta ) // rounding code can't handle zero
 	{
 		// round to nearest cache timestamp (even if not in cache)
@@ -394,6 +694,42 @@ void Nes_Recorder::skip( int delta )
 	}
 }
 
+void Nes_Recorder::clear_latency()
+{
+	seek_latency_.clear();
+	skip_latency_.clear();
+	reverse_latency_.clear();
+	film_->unpack_latency().clear();
+}
+
+static blargg_err_t write_str( Data_Writer& out, const char* str )
+{
+	return out.write( str, strlen( str ) );
+}
+
+blargg_err_t Nes_Recorder::write_stats( Data_Writer& out ) const
+{
+	frame_count_t length = (film_->blank() ? 0 : film_->length());
+	long packed = film_->packed_size();
+	long per_minute = 0;
+	if ( length )
+		per_minute = (long) ((double) packed * (frame_rate * 60) / length);
+	
+	char str [256];
+	sprintf( str, "{\"frames\": %ld, \"period\": %ld, \"cache_period\": %d, "
+			"\"packed_bytes\": %ld, \"bytes_per_minute\": %ld, \"seek\": ",
+			(long) length, (long) film_->period(), cache_period_, packed, per_minute );
+	RETURN_ERR( write_str( out, str ) );
+	RETURN_ERR( seek_latency_.write_json( out ) );
+	RETURN_ERR( write_str( out, ", \"skip\": " ) );
+	RETURN_ERR( skip_latency_.write_json( out ) );
+	RETURN_ERR( write_str( out, ", \"reverse\": " ) );
+	RETURN_ERR( reverse_latency_.write_json( out ) );
+	RETURN_ERR( write_str( out, ", \"unpack\": " ) );
+	RETURN_ERR( film_->unpack_latency().write_json( out ) );
+	return write_str( out, "}\n" );
+}
+
 // Reverse handling
 
 // Get index of frame at given timestamp in reverse frames
@@ -405,7 +741,140 @@ inline int Nes_Recorder::reverse_index( frame_count_t time ) const
 	return index;
 }
 
-// Generate frame at given timestamp into proper position in reverse frames
+// Reverse frames are packed one scanline at a time. A count byte below 0x80 is
+// followed by count + 1 literal pixels, otherwise the next pixel is repeated
+// count - 0x7D times.
+
+int const min_run = 3;
+int const max_run = 0xFF - 0x7D;
+int const max_literal = 0x80;
+
+static byte* pack_row( byte const* in, byte* out )
+{
+	int const width = Nes_Emu::image_width;
+	
+	// rows with too many changes to benefit are stored as plain literals, which
+	// is much faster to pack and unpack
+	int changes = 0;
+	for ( int i = 1; i < width; i++ )
+		changes += (in [i] != in [i - 1]);
+	if ( changes >= width / 2 )
+	{
+		for ( int n = width / max_literal; n--; )
+		{
+			*out++ = max_literal - 1;
+			memcpy( out, in, max_literal );
+			out += max_literal;
+			in += max_literal;
+		}
+		return out;
+	}
+	
+	byte const* const end = in + width;
+	while ( in < end )
+	{
+		byte const* p = in + 1;
+		while ( p < end && *p == *in && p - in < max_run )
+			p++;
+		
+		if ( p - in >= min_run )
+		{
+			*out++ = (byte) (p - in + 0x7D);
+			*out++ = *in;
+			in = p;
+		}
+		else
+		{
+			// literals until next run worth coding
+			p = in;
+			while ( p < end && p - in < max_literal &&
+					!(end - p >= min_run && p [0] == p [1] && p [1] == p [2]) )
+				p++;
+			
+			*out++ = (byte) (p - in - 1);
+			memcpy( out, in, p - in );
+			out += p - in;
+			in = p;
+		}
+	}
+	return out;
+}
+
+static byte const* unpack_row( byte const* in, byte* out )
+{
+	byte* const end = out + Nes_Emu::image_width;
+	while ( out < end )
+	{
+		int count = *in++;
+		if ( count < 0x80 )
+		{
+			count++;
+			memcpy( out, in, count );
+			in += count;
+		}
+		else
+		{
+			count -= 0x7D;
+			memset( out, *in++, count );
+		}
+		out += count;
+	}
+	return in;
+}
+
+blargg_err_t Nes_Recorder::pack_frame( saved_frame_t& f )
+{
+	f.info = render_frame;
+	
+	blip_sample_t* samples = (blip_sample_t*) pack_buf;
+	f.info.sample_count = base::read_samples( samples, max_samples );
+	byte* out = (byte*) (samples + f.info.sample_count);
+	
+	if ( !emu.ppu.host_pixels )
+	{
+		f.info.pixels = 0; // no image
+	}
+	else
+	{
+		byte const* in = render_frame.pixels;
+		for ( int n = image_height; n--; in += render_frame.pitch )
+			out = pack_row( in, out );
+	}
+	
+	long size = out - pack_buf;
+	assert( size <= max_packed_frame );
+	if ( f.capacity < size || size < f.capacity / 2 )
+	{
+		// round up so slightly larger frames later don't need another realloc
+		long new_capacity = (size + 0xFFF) & ~0xFFF;
+		void* p = realloc( f.data, new_capacity );
+		CHECK_ALLOC( p );
+		f.data = (byte*) p;
+		f.capacity = new_capacity;
+	}
+	memcpy( f.data, pack_buf, size );
+	return 0;
+}
+
+void Nes_Recorder::unpack_frame( saved_frame_t const& f )
+{
+	byte* out = render_frame.pixels;
+	long pitch = render_frame.pitch;
+	render_frame = f.info;
+	render_frame.pixels = out;
+	render_frame.pitch = pitch;
+	
+	palette_frame = 0; // palette isn't one last captured
+	
+	if ( f.info.pixels && emu.ppu.host_pixels )
+	{
+		byte const* in = f.data + f.info.sample_count * sizeof (blip_sample_t);
+		for ( int n = image_height; n--; out += pitch )
+			in = unpack_row( in, out );
+	}
+}
+
+// Generate frame at given timestamp and pack it into proper position in reverse frames
 void Nes_Recorder::reverse_fill( frame_count_t time )
 {
 	if ( time >= film_->begin() )
@@ -414,12 +883,21 @@ void Nes_Recorder::reverse_fill( frame_count_t time )
 		if ( base::timestamp() != time )
 			seek_( time );
 		
-		saved_frame_t* frame = &frames [reverse_index( time )];
-		frame_ = frame;
+		frame_ = &render_frame;
 		if ( time % frames_size == frames_size - 1 )
 			fade_sound_out = true;
 		replay_frame();
-		frame->sample_count = base::read_samples( frame->samples, frame->max_samples );
+		
+		saved_frame_t& f = frames [reverse_index( time )];
+		if ( pack_frame( f ) )
+		{
+			check( false ); // out of memory; frame will have no image or sound
+			f.info.sample_count = 0;
+			f.info.pixels = 0;
+			free( f.data );
+			f.data = 0;
+			f.capacity = 0;
+		}
 	}
 }
 
@@ -431,6 +909,7 @@ void Nes_Recorder::prev_frame()
 		return;
 	}
 	
+	Nes_Latency::timer_t timer( reverse_latency_ );
 	int offset = tell_ % frames_size;
 	frame_count_t aligned = tell_ - offset;
 	if ( reverse_enabled )
@@ -450,7 +929,10 @@ void Nes_Recorder::prev_frame()
 	}
 	
 	tell_--;
-	frame_ = &frames [reverse_index( tell_ )];
+	unpack_frame( frames [reverse_index( tell_ )] );
+	
+	// frames were rendered out of order, so change detection doesn't apply
+	invalidate_frame();
 }
 
 long Nes_Recorder::read_samples( short* out, long count )
@@ -462,7 +944,7 @@ long Nes_Recorder::read_samples( short* out, long count )
 	// copy samples in reverse without reversing left and right channels
 	// to do: optimize?
 	count = frame().sample_count;
-	blip_sample_t const* in = STATIC_CAST(saved_frame_t const&,frame()).samples;
+	blip_sample_t const* in = (blip_sample_t const*) frames [reverse_index( tell_ )].data;
 	int step = frame().chan_count - 1;
 	for ( int i = 0; i < count; i++ )
 		out [count - 1 - (i ^ step)] = in [i];
@@ -8,12 +8,15 @@
 
 #include "Nes_Emu.h"
 #include "Nes_Film.h"
+#include "Nes_Rewind_Cache.h"
 
 class Nes_Recorder : public Nes_Emu {
 public:
 	// Set new film to use for recording and playback. If film isn't empty, seeks to
 	// its beginning (or to optional specified fime). Film *must* be loaded before
-	// using the recorder for emulation.
+	// using the recorder for emulation. Film is packed on the recorder's worker
+	// thread until another film is set, so it must not be destroyed before then
+	// or before the recorder.
 	void set_film( Nes_Film*, frame_count_t );
 	void set_film( Nes_Film* f ) { set_film( f, f->begin() ); }
 	
@@ -50,18 +53,59 @@ public:
 // Additional features
 	
 	// Disable reverse support and optionally use less-frequent cache snapshots, in order
-	// to drastically reduce the required height of the graphics buffer and memory usage.
-	// If used, must be called one time *before* any use of emulator.
+	// to reduce memory usage. If used, must be called one time *before* any use of
+	// emulator.
 	void disable_reverse( int cache_period_secs = 5 );
 	
+	// Keep snapshots of recent play in tiers, so seeking and reversing anywhere
+	// in it is fast: one every frame for the last second, one every 'spacing'
+	// frames for the last minute, then progressively sparser. Snapshots are delta
+	// packed, and the oldest are discarded to keep memory used near 'budget'
+	// bytes. If used, must be called one time *before* any use of emulator.
+	void set_rewind( long budget, int spacing = 8 );
+	
 	// Call when current film has been significantly changed (loaded from file).
 	// Doesn't need to be called if film was merely trimmed.
 	void film_changed();
 	
+	// Load branch into film (see Nes_Film::load_branch()) and stay at current time.
+	// If branch has the same recording up to current time, emulation continues
+	// from there without seeking, so switching between branches that share their
+	// beginning is immediate. Otherwise seeks to current time in branch, or to
+	// whichever end of it is nearest.
+	blargg_err_t load_branch( Nes_Film_Branch const& );
+	
 	// Attempt to add keyframe to film at current timestamp, which will make future
 	// seeking to this point faster after film is later loaded.
 	void record_keyframe();
 	
+	// Add keyframes to film every 'interval' frames wherever it has none, by
+	// replaying the recording from the snapshots already in it. Interval is
+	// rounded up to a multiple of the film's period, which is the default, so
+	// a film should be cleared with a short period before one with few snapshots
+	// is read into it. Stretches between existing snapshots are independent, so
+	// they are replayed in parallel on thread_count worker threads (see
+	// Nes_Worker.h). Snapshots are checked against any hashes of them in film
+	// (see Nes_Film::write_inputs()).
+	blargg_err_t index_film( int thread_count = 1, frame_count_t interval = 0 );
+	
+	// Add keyframes as index_film() does, but replay on a background worker thread,
+	// so a film that has just been read can be played right away. Film is replayed
+	// an interval at a time, and keyframes are added whenever the recorder seeks or
+	// update_index() is called. Stops if another film is set or the current one is
+	// recorded over. Cartridge must not be changed or closed until indexing() is
+	// false, or until after another film is set. Without worker threads (see
+	// Nes_Worker.h), the whole film is indexed before returning, as index_film() does.
+	blargg_err_t begin_index( frame_count_t interval = 0 );
+	
+	// Add keyframes replayed so far and continue. Returns error if they, or any
+	// snapshots taken while playing, don't match the film's hashes, which also
+	// stops replaying.
+	blargg_err_t update_index();
+	
+	// True while keyframes are being added in the background
+	bool indexing() const { return index_bg != 0; }
+	
 	// Get time of nearby key frame within +/- 45 seconds, otherwise return time unchanged.
 	// Seeking to times of key frames is much faster than an arbitrary time. Time
 	// is constrained to film if it falls outside.
@@ -78,10 +122,25 @@ public:
 	// or from other emulators.
 	void enable_resync( bool b = true ) { resync_enabled = b; }
 	
-	// Height of graphics buffer needed when running forward (next_frame() or
-	// emulate_frame(), but not prev_frame())
+	// Height of graphics buffer needed. The same height suffices for prev_frame(),
+	// since frames generated for reversing are kept packed and unpacked in place.
 	enum { forward_buffer_height = Nes_Ppu::buffer_height };
 	
+	// Time taken by each call to seek(), skip() and prev_frame() (see Nes_Latency.h).
+	// Seek times include the seeks done by skip().
+	Nes_Latency& seek_latency() { return seek_latency_; }
+	Nes_Latency& skip_latency() { return skip_latency_; }
+	Nes_Latency& reverse_latency() { return reverse_latency_; }
+	
+	// Clear latencies above and film's unpack_latency()
+	void clear_latency();
+	
+	// Write latencies, film's unpack_latency(), and film's length, period and
+	// memory use as JSON object, for tracking performance over time. Getting memory
+	// use packs the block being recorded and waits for any being packed in the
+	// background, so call between recordings rather than every frame.
+	blargg_err_t write_stats( Data_Writer& ) const;
+	
 public:
 	Nes_Recorder();
 	virtual ~Nes_Recorder();
@@ -94,12 +153,15 @@ private:
 	typedef Nes_Emu base;
 	
 	// snapshots
-	Nes_State* cache;
+	Nes_Worker worker;      // packs film and cache; destroyed after them
+	bool pack_in_background; // false for index jobs, which run on worker threads
+	Nes_Rewind_Cache cache;
 	int cache_size;
 	int cache_period_;
+	long rewind_budget;
+	int rewind_spacing;
 	Nes_Film* film_;
 	void clear_cache();
-	int cache_index( frame_count_t ) const;
 	Nes_State_ const* nearest_snapshot( frame_count_t ) const;
 	
 	// film
@@ -112,18 +174,47 @@ private:
 	void seek_( frame_count_t );
 	frame_count_t advancing_frame();
 	void loading_state( Nes_State const& );
+	Nes_Latency seek_latency_;
+	Nes_Latency skip_latency_;
+	Nes_Latency reverse_latency_;
+	
+	// keyframe indexing
+	struct index_job_t;
+	struct index_bg_t;
+	index_bg_t* index_bg; // background indexing, or NULL
+	blargg_err_t index_error;
+	static void index_segment( void* );
+	frame_count_t index_interval( frame_count_t ) const;
+	frame_count_t next_snapshot( frame_count_t ) const;
+	blargg_err_t index_film_( index_job_t*, int job_count, int thread_count );
+	blargg_err_t init_index_job( index_job_t&, frame_count_t interval );
+	blargg_err_t begin_index_job( index_job_t&, frame_count_t begin, frame_count_t end,
+			Nes_State_ const& first );
+	blargg_err_t end_index_job( index_job_t& );
+	blargg_err_t continue_index();
+	void end_index();
 	
 	// reverse handling
 	enum { frames_size = frame_rate };
-	struct saved_frame_t : Nes_Emu::frame_t {
-		enum { max_samples = 2048 };
-		blip_sample_t samples [max_samples];
+	enum { max_samples = 2048 };
+	enum { max_packed_row = image_width + image_width / 128 }; // all literals
+	enum { max_packed_frame = max_samples * sizeof (blip_sample_t) +
+			image_height * max_packed_row };
+	struct saved_frame_t
+	{
+		Nes_Emu::frame_t info;
+		BOOST::uint8_t* data; // samples, then image with each scanline run-length coded
+		long capacity;
 	};
 	saved_frame_t* frames;
+	BOOST::uint8_t* pack_buf; // worst-case size for packing one frame
+	frame_t render_frame;
 	bool reverse_enabled;
 	bool reverse_allowed;
 	void reverse_fill( frame_count_t );
 	int reverse_index( frame_count_t ) const; // index for given frame
+	blargg_err_t pack_frame( saved_frame_t& );
+	void unpack_frame( saved_frame_t const& );
 };
 
 inline frame_count_t Nes_Recorder::tell() const { return film_->constrain( tell_ ); }
@@ -133,7 +224,6 @@ inline void Nes_Recorder::film_changed() { set_film( &film(), film().constrain(
 inline void Nes_Recorder::disable_reverse( int new_cache_period )
 {
 	reverse_allowed = false;
-	buffer_height_ = Nes_Ppu::buffer_height;
 	cache_period_ = new_cache_period * frame_rate;
 	cache_size = 2 * 60 * frame_rate / cache_period_ + 7; // +7 reduces contention
 }
@@ -0,0 +1,199 @@
+
+// Nes_Emu 0.7.0
+
+#include "Nes_Rewind_Cache.h"
+
+#include <stdlib.h>
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+int const block_size = Nes_Film_Data::block_size;
+
+Nes_Rewind_Cache::Nes_Rewind_Cache()
+{
+	tier_count = 0;
+	budget = 0;
+	for ( int i = 0; i < max_tiers; i++ )
+		tiers [i].times = 0;
+}
+
+Nes_Rewind_Cache::~Nes_Rewind_Cache()
+{
+	for ( int i = 0; i < max_tiers; i++ )
+		free( tiers [i].times );
+}
+
+void Nes_Rewind_Cache::set_worker( Nes_Worker* w )
+{
+	for ( int i = 0; i < max_tiers; i++ )
+		tiers [i].data.set_worker( w );
+}
+
+blargg_err_t Nes_Rewind_Cache::add_tier( frame_count_t spacing, int count )
+{
+	require( tier_count < max_tiers && spacing > 0 && count > 0 );
+	require( !tier_count || spacing % tiers [tier_count - 1].spacing == 0 );
+	
+	count = (count + block_size - 1) / block_size * block_size;
+	tier_t& t = tiers [tier_count];
+	CHECK_ALLOC( t.times = (frame_count_t*) malloc( count * sizeof *t.times ) );
+	t.spacing = spacing;
+	t.count = count;
+	t.data.clear( 1 ); // data's joypad area isn't used
+	t.data.set_packing( Nes_Film_Data::pack_delta );
+	RETURN_ERR( t.data.resize( count / block_size ) );
+	for ( int i = 0; i < count; i++ )
+		t.times [i] = invalid_frame_count;
+	tier_count++;
+	return 0;
+}
+
+void Nes_Rewind_Cache::clear()
+{
+	for ( int n = 0; n < tier_count; n++ )
+	{
+		tier_t& t = tiers [n];
+		for ( int i = 0; i < t.count; i++ )
+			t.times [i] = invalid_frame_count;
+		for ( int i = 0; i < t.count / block_size; i++ )
+			t.data.free_block( i );
+	}
+}
+
+Nes_State_* Nes_Rewind_Cache::modify( frame_count_t time )
+{
+	int n = tier_count;
+	while ( n-- && time % tiers [n].spacing ) { }
+	if ( n < 0 )
+		return 0;
+	
+	tier_t& t = tiers [n];
+	int i = (time / t.spacing) % t.count;
+	if ( i % block_size == 0 )
+	{
+		// start block afresh rather than unpacking oldest snapshots only to replace them
+		for ( int j = i; j < i + block_size; j++ )
+			t.times [j] = invalid_frame_count;
+		t.data.free_block( i / block_size );
+		
+		if ( budget )
+			free_oldest( &t, i / block_size ); // make room before starting new block
+	}
+	
+	Nes_Film_Data::block_t* b = t.data.write( i / block_size );
+	if ( !b )
+		return 0;
+	t.times [i] = time;
+	return &b->states [i % block_size];
+}
+
+void Nes_Rewind_Cache::invalidate( frame_count_t time )
+{
+	for ( int n = 0; n < tier_count; n++ )
+	{
+		tier_t& t = tiers [n];
+		int i = (time / t.spacing) % t.count;
+		if ( t.times [i] == time )
+			t.times [i] = invalid_frame_count;
+	}
+}
+
+void Nes_Rewind_Cache::invalidate_after( frame_count_t time )
+{
+	for ( int n = 0; n < tier_count; n++ )
+	{
+		tier_t& t = tiers [n];
+		for ( int i = 0; i < t.count; i++ )
+			if ( t.times [i] > time )
+				t.times [i] = invalid_frame_count;
+	}
+}
+
+Nes_State_ const* Nes_Rewind_Cache::nearest( frame_count_t time, frame_count_t after ) const
+{
+	tier_t const* found = 0;
+	int found_index = 0;
+	for ( int n = 0; n < tier_count; n++ )
+	{
+		// search back no further than tier holds, or snapshot already found
+		tier_t const& t = tiers [n];
+		frame_count_t s = time - time % t.spacing;
+		for ( int count = t.count; count-- && s > after && s >= 0; s -= t.spacing )
+		{
+			int i = (s / t.spacing) % t.count;
+			if ( t.times [i] == s )
+			{
+				found = &t;
+				found_index = i;
+				after = s;
+				break;
+			}
+		}
+	}
+	
+	if ( !found )
+		return 0;
+	
+	Nes_State_ const& ss = found->data.read( found_index / block_size ).states [found_index % block_size];
+	assert( ss.timestamp() == after );
+	return &ss;
+}
+
+long Nes_Rewind_Cache::packed_size() const
+{
+	long total = 0;
+	for ( int n = 0; n < tier_count; n++ )
+		for ( int b = 0; b < tiers [n].count / block_size; b++ )
+			total += tiers [n].data.packed_size( b );
+	return total;
+}
+
+void Nes_Rewind_Cache::free_oldest( tier_t const* keep_tier, int keep_block )
+{
+	while ( packed_size() > budget )
+	{
+		// find block whose newest snapshot is oldest
+		tier_t* victim = 0;
+		int victim_block = 0;
+		frame_count_t oldest = 0;
+		for ( int n = tier_count; n--; )
+		{
+			tier_t& t = tiers [n];
+			for ( int b = 0; b < t.count / block_size; b++ )
+			{
+				if ( (&t == keep_tier && b == keep_block) || !t.data.packed_size( b ) )
+					continue;
+				
+				frame_count_t newest = -1; // stale blocks are freed first
+				for ( int i = b * block_size; i < (b + 1) * block_size; i++ )
+					if ( t.times [i] != invalid_frame_count && t.times [i] > newest )
+						newest = t.times [i];
+				
+				if ( !victim || newest < oldest )
+				{
+					oldest = newest;
+					victim = &t;
+					victim_block = b;
+				}
+			}
+		}
+		
+		if ( !victim )
+			break;
+		
+		for ( int i = victim_block * block_size; i < (victim_block + 1) * block_size; i++ )
+			victim->times [i] = invalid_frame_count;
+		victim->data.free_block( victim_block );
+	}
+}
@@ -0,0 +1,79 @@
+
+// Tiered cache of recent snapshots, kept compressed in memory
+
+// Nes_Emu 0.7.0
+
+#ifndef NES_REWIND_CACHE_H
+#define NES_REWIND_CACHE_H
+
+#include "blargg_common.h"
+#include "Nes_Film_Data.h"
+
+// Keeps snapshots in tiers of increasing spacing, for example every frame for a
+// second, then every 8 frames for a minute, then every 64 frames for a while
+// longer. Each tier is a ring holding a fixed number of snapshots, so saving one
+// every frame costs the same however long play goes on. Snapshots in a tier are
+// delta packed in groups as Nes_Film_Data does.
+class Nes_Rewind_Cache {
+public:
+	Nes_Rewind_Cache();
+	~Nes_Rewind_Cache();
+	
+	// Add tier keeping a snapshot every 'spacing' frames, up to 'count' of them.
+	// Tiers must be added from finest to coarsest, and each tier's spacing must
+	// be a multiple of the previous one's.
+	enum { max_tiers = 6 };
+	blargg_err_t add_tier( frame_count_t spacing, int count );
+	
+	// Limit memory used by packed snapshots to about 'bytes'. When exceeded, the
+	// oldest snapshots are discarded a block at a time. Zero removes limit.
+	void set_budget( long bytes ) { budget = bytes; }
+	
+	// Pack snapshots of all tiers on worker's threads, or on the calling thread if
+	// NULL (see Nes_Film_Data::set_worker())
+	void set_worker( Nes_Worker* );
+	
+	// Number of frames between snapshots of finest tier
+	frame_count_t spacing() const { return tier_count ? tiers [0].spacing : 0; }
+	
+	// Discard all snapshots
+	void clear();
+	
+	// Snapshot that state at time should be saved to, or NULL if time isn't kept
+	// or out of memory. Each time is kept only by the coarsest tier it falls on.
+	Nes_State_* modify( frame_count_t );
+	
+	// Discard snapshot at time, if any
+	void invalidate( frame_count_t );
+	
+	// Discard snapshots after time
+	void invalidate_after( frame_count_t );
+	
+	// Most recent snapshot at or before time and after 'after', or NULL if none.
+	// Valid until cache is next modified or another snapshot is found.
+	Nes_State_ const* nearest( frame_count_t time, frame_count_t after ) const;
+	
+	// Approximate memory used by packed snapshots
+	long packed_size() const;
+
+private:
+	// noncopyable
+	Nes_Rewind_Cache( const Nes_Rewind_Cache& );
+	Nes_Rewind_Cache& operator = ( const Nes_Rewind_Cache& );
+	
+	struct tier_t
+	{
+		Nes_Film_Data data;
+		frame_count_t* times; // timestamp of each snapshot, kept unpacked for searching
+		frame_count_t spacing;
+		int count;
+	};
+	tier_t tiers [max_tiers];
+	int tier_count;
+	long budget;
+	
+	void free_oldest( tier_t const* keep_tier, int keep_block );
+};
+
+#endif
+
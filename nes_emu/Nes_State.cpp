@@ -253,6 +253,7 @@ blargg_err_t Nes_State_::read_blocks( Nes_File_Reader& in )
 		
 		case FOUR_CHAR('MAPR'):
 			mapper->size = in.remain();
+			mapper->sound_offset = -1; // mapper isn't known
 			RETURN_ERR( in.read_block_data( mapper->data, sizeof mapper->data ) );
 			mapper_valid = true;
 			break;
@@ -119,7 +119,8 @@ public:
 	blargg_err_t read_sta_file( Auto_File_Reader );
 };
 
-frame_count_t const invalid_frame_count = LONG_MAX / 2 + 1; // a large positive value
+// a large positive value, which must survive being stored in nes_state_t::frame_count
+frame_count_t const invalid_frame_count = 0x7FFFFFFF / 2 + 1;
 
 int mem_differs( void const* in, int compare, unsigned long count );
 
@@ -29,7 +29,6 @@ Nes_Vrc6_Apu::~Nes_Vrc6_Apu()
 
 void Nes_Vrc6_Apu::reset()
 {
-	last_time = 0;
 	for ( int i = 0; i < osc_count; i++ )
 	{
 		Vrc6_Osc& osc = oscs [i];
@@ -39,6 +38,7 @@ void Nes_Vrc6_Apu::reset()
 		osc.last_amp = 0;
 		osc.phase = 1;
 		osc.amp = 0;
+		osc.last_time = 0;
 	}
 }
 
@@ -48,13 +48,15 @@ void Nes_Vrc6_Apu::output( Blip_Buffer* buf )
 		osc_output( i, buf );
 }
 
-void Nes_Vrc6_Apu::run_until( nes_time_t time )
+void Nes_Vrc6_Apu::run_osc( int i, nes_time_t time )
 {
-	require( time >= last_time );
-	run_square( oscs [0], time );
-	run_square( oscs [1], time );
-	run_saw( time );
-	last_time = time;
+	Vrc6_Osc& osc = oscs [i];
+	require( time >= osc.last_time );
+	if ( i < 2 )
+		run_square( osc, time );
+	else
+		run_saw( time );
+	osc.last_time = time;
 }
 
 void Nes_Vrc6_Apu::write_osc( nes_time_t time, int osc_index, int reg, int data )
@@ -62,17 +64,26 @@ void Nes_Vrc6_Apu::write_osc( nes_time_t time, int osc_index, int reg, int data
 	require( (unsigned) osc_index < osc_count );
 	require( (unsigned) reg < reg_count );
 	
-	run_until( time );
+	// Square oscillators are independent, so one not being written to can run
+	// later in one pass. Saw restarts its delay whenever run while silent, so it
+	// is still run for every write.
+	run_osc( osc_index, time );
+	if ( osc_index != 2 )
+		run_osc( 2, time );
 	oscs [osc_index].regs [reg] = data;
 }
 
 void Nes_Vrc6_Apu::end_frame( nes_time_t time )
 {
-	if ( time > last_time )
-		run_until( time );
-	
-	assert( last_time >= time );
-	last_time -= time;
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		Vrc6_Osc& osc = oscs [i];
+		if ( time > osc.last_time )
+			run_osc( i, time );
+		
+		assert( osc.last_time >= time );
+		osc.last_time -= time;
+	}
 }
 
 void Nes_Vrc6_Apu::save_state( vrc6_apu_state_t* out ) const
@@ -119,7 +130,7 @@ void Nes_Vrc6_Apu::run_square( Vrc6_Osc& osc, nes_time_t end_time )
 	int gate = osc.regs [0] & 0x80;
 	int duty = ((osc.regs [0] >> 4) & 7) + 1;
 	int delta = ((gate || osc.phase < duty) ? volume : 0) - osc.last_amp;
-	nes_time_t time = last_time;
+	nes_time_t time = osc.last_time;
 	if ( delta )
 	{
 		osc.last_amp += delta;
@@ -168,7 +179,7 @@ void Nes_Vrc6_Apu::run_saw( nes_time_t end_time )
 	
 	int amp = osc.amp;
 	int amp_step = osc.regs [0] & 0x3F;
-	nes_time_t time = last_time;
+	nes_time_t time = osc.last_time;
 	int last_amp = osc.last_amp;
 	if ( !(osc.regs [2] & 0x80) || !(amp_step | amp) )
 	{
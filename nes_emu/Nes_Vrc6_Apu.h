@@ -48,6 +48,7 @@ private:
 		int last_amp;
 		int phase;
 		int amp; // only used by saw
+		nes_time_t last_time; // each oscillator is only run when necessary
 		
 		int period() const
 		{
@@ -56,12 +57,11 @@ private:
 	};
 	
 	Vrc6_Osc oscs [osc_count];
-	nes_time_t last_time;
 	
 	Blip_Synth<blip_med_quality,1> saw_synth;
 	Blip_Synth<blip_good_quality,1> square_synth;
 	
-	void run_until( nes_time_t );
+	void run_osc( int osc, nes_time_t );
 	void run_square( Vrc6_Osc& osc, nes_time_t );
 	void run_saw( nes_time_t );
 };
@@ -0,0 +1,193 @@
+
+// Nes_Emu 0.7.0
+
+#include "Nes_Worker.h"
+
+#ifdef NES_WORKER_THREADS
+	#include <pthread.h>
+#endif
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+Nes_Worker::Nes_Worker()
+{
+	pool = 0;
+	thread_count_ = 0;
+}
+
+Nes_Worker::~Nes_Worker()
+{
+	stop();
+}
+
+#ifdef NES_WORKER_THREADS
+
+struct Nes_Worker::pool_t
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t added;   // job queued or quit set
+	pthread_cond_t done;    // job finished
+	struct job_t {
+		func_t func;
+		void* data;
+	} jobs [max_jobs];      // circular queue of jobs not yet started
+	int first;
+	int queued;
+	int running;
+	bool quit;
+	int count;              // number of threads
+	pthread_t threads [max_threads];
+};
+
+void* Nes_Worker::thread_func( void* arg )
+{
+	pool_t* pool = (pool_t*) arg;
+	pthread_mutex_lock( &pool->mutex );
+	while ( true )
+	{
+		while ( !pool->queued && !pool->quit )
+			pthread_cond_wait( &pool->added, &pool->mutex );
+		if ( !pool->queued )
+			break; // finish queued jobs before quitting
+		
+		pool_t::job_t job = pool->jobs [pool->first];
+		pool->first = (pool->first + 1) % max_jobs;
+		pool->queued--;
+		pool->running++;
+		pthread_mutex_unlock( &pool->mutex );
+		
+		job.func( job.data );
+		
+		pthread_mutex_lock( &pool->mutex );
+		pool->running--;
+		pthread_cond_broadcast( &pool->done );
+	}
+	pthread_mutex_unlock( &pool->mutex );
+	return 0;
+}
+
+blargg_err_t Nes_Worker::start( int n )
+{
+	require( 0 <= n && n <= max_threads );
+	stop();
+	if ( n > 0 )
+	{
+		CHECK_ALLOC( pool = BLARGG_NEW pool_t );
+		pool->first = 0;
+		pool->queued = 0;
+		pool->running = 0;
+		pool->quit = false;
+		pool->count = 0;
+		pthread_mutex_init( &pool->mutex, 0 );
+		pthread_cond_init( &pool->added, 0 );
+		pthread_cond_init( &pool->done, 0 );
+		
+		while ( pool->count < n )
+		{
+			if ( pthread_create( &pool->threads [pool->count], 0, thread_func, pool ) )
+			{
+				stop();
+				return "Couldn't create thread";
+			}
+			pool->count++;
+		}
+	}
+	thread_count_ = n;
+	return 0;
+}
+
+void Nes_Worker::stop()
+{
+	if ( pool )
+	{
+		pthread_mutex_lock( &pool->mutex );
+		pool->quit = true;
+		pthread_cond_broadcast( &pool->added );
+		pthread_mutex_unlock( &pool->mutex );
+		
+		for ( int i = 0; i < pool->count; i++ )
+			pthread_join( pool->threads [i], 0 );
+		
+		pthread_cond_destroy( &pool->done );
+		pthread_cond_destroy( &pool->added );
+		pthread_mutex_destroy( &pool->mutex );
+		delete pool;
+		pool = 0;
+	}
+	thread_count_ = 0;
+}
+
+void Nes_Worker::add( func_t func, void* data )
+{
+	if ( !pool )
+	{
+		func( data );
+		return;
+	}
+	
+	pthread_mutex_lock( &pool->mutex );
+	while ( pool->queued + pool->running >= max_jobs )
+		pthread_cond_wait( &pool->done, &pool->mutex );
+	pool_t::job_t& job = pool->jobs [(pool->first + pool->queued) % max_jobs];
+	job.func = func;
+	job.data = data;
+	pool->queued++;
+	pthread_cond_signal( &pool->added );
+	pthread_mutex_unlock( &pool->mutex );
+}
+
+void Nes_Worker::wait()
+{
+	if ( pool )
+	{
+		pthread_mutex_lock( &pool->mutex );
+		while ( pool->queued + pool->running )
+			pthread_cond_wait( &pool->done, &pool->mutex );
+		pthread_mutex_unlock( &pool->mutex );
+	}
+}
+
+int Nes_Worker::busy() const
+{
+	int n = 0;
+	if ( pool )
+	{
+		pthread_mutex_lock( &pool->mutex );
+		n = pool->queued + pool->running;
+		pthread_mutex_unlock( &pool->mutex );
+	}
+	return n;
+}
+
+#else
+
+struct Nes_Worker::pool_t { };
+
+void* Nes_Worker::thread_func( void* ) { return 0; }
+
+blargg_err_t Nes_Worker::start( int n )
+{
+	require( 0 <= n && n <= max_threads );
+	return 0; // jobs run on calling thread
+}
+
+void Nes_Worker::stop() { }
+
+void Nes_Worker::add( func_t func, void* data ) { func( data ); }
+
+void Nes_Worker::wait() { }
+
+int Nes_Worker::busy() const { return 0; }
+
+#endif
@@ -0,0 +1,54 @@
+
+// Background threads for compression and other batch work
+
+// Nes_Emu 0.7.0
+
+#ifndef NES_WORKER_H
+#define NES_WORKER_H
+
+#include "blargg_common.h"
+
+// Runs queued jobs on one or more background threads. Threads are only used if
+// compiled with NES_WORKER_THREADS defined; otherwise each job runs on the
+// calling thread when it's queued.
+class Nes_Worker {
+public:
+	Nes_Worker();
+	~Nes_Worker(); // waits for queued jobs
+	
+	// Start thread_count threads (at most max_threads), stopping any already
+	// running. If thread_count is zero, jobs run on the calling thread. Threads
+	// run at normal priority, since callers wait on their jobs.
+	enum { max_threads = 8 };
+	blargg_err_t start( int thread_count = 1 );
+	
+	// Number of worker threads, or 0 if jobs run on calling thread
+	int thread_count() const { return thread_count_; }
+	
+	// Queue func( data ) to be run by a worker thread. Jobs are started in the
+	// order queued. If max_jobs are already queued or running, first waits
+	// for one to finish.
+	enum { max_jobs = 32 };
+	typedef void (*func_t)( void* data );
+	void add( func_t, void* data );
+	
+	// Wait until all queued jobs have finished
+	void wait();
+	
+	// Number of jobs queued or still running
+	int busy() const;
+	
+private:
+	// noncopyable
+	Nes_Worker( const Nes_Worker& );
+	Nes_Worker& operator = ( const Nes_Worker& );
+	
+	struct pool_t;
+	pool_t* pool;
+	int thread_count_;
+	
+	void stop();
+	static void* thread_func( void* );
+};
+
+#endif
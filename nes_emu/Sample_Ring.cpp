@@ -0,0 +1,207 @@
+
+// Nes_Emu 0.7.0
+
+#include "Sample_Ring.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+// Counts shared between threads. The side that owns a count stores it with
+// release semantics after touching the samples; the other side loads it with
+// acquire semantics before touching them. Where there's no acquire/release
+// primitive, a full memory barrier is used instead.
+#if defined (__ATOMIC_ACQUIRE)
+	// GCC 4.7 and later, clang
+	#define LOAD_ACQUIRE( var )         __atomic_load_n( &(var), __ATOMIC_ACQUIRE )
+	#define STORE_RELEASE( var, n )     __atomic_store_n( &(var), (n), __ATOMIC_RELEASE )
+#else
+	#if defined (_MSC_VER) && (defined (_M_IX86) || defined (_M_X64))
+		// x86 doesn't reorder loads with loads or stores with stores, so only the
+		// compiler needs to be kept from reordering
+		#include <intrin.h>
+		#define MEMORY_BARRIER()    _ReadWriteBarrier()
+	#elif defined (_WIN32)
+		#include <windows.h>
+		#define MEMORY_BARRIER()    MemoryBarrier()
+	#elif defined (__GNUC__)
+		// GCC 4.1 and later
+		#define MEMORY_BARRIER()    __sync_synchronize()
+	#else
+		#error "Sample_Ring needs a memory barrier for this compiler"
+	#endif
+
+	static inline unsigned long load_acquire( unsigned long const volatile* p )
+	{
+		unsigned long n = *p;
+		MEMORY_BARRIER();
+		return n;
+	}
+
+	static inline void store_release( unsigned long volatile* p, unsigned long n )
+	{
+		MEMORY_BARRIER();
+		*p = n;
+	}
+
+	#define LOAD_ACQUIRE( var )         load_acquire( &(var) )
+	#define STORE_RELEASE( var, n )     store_release( &(var), (n) )
+#endif
+
+Sample_Ring::Sample_Ring()
+{
+	buf = NULL;
+	mask = -1;
+	clear();
+}
+
+Sample_Ring::~Sample_Ring()
+{
+	free( buf );
+}
+
+void Sample_Ring::clear()
+{
+	write_count = 0;
+	read_count = 0;
+	underruns = 0;
+	overruns = 0;
+}
+
+blargg_err_t Sample_Ring::resize( long count )
+{
+	require( count > 0 );
+	long size = 2;
+	while ( size < count )
+		size *= 2;
+	
+	if ( size != capacity() )
+	{
+		void* p = realloc( buf, size * sizeof *buf );
+		CHECK_ALLOC( p );
+		buf = (blip_sample_t*) p;
+		mask = size - 1;
+	}
+	clear();
+	return 0;
+}
+
+// Producer
+
+long Sample_Ring::space_avail() const
+{
+	return capacity() - (long) (write_count - LOAD_ACQUIRE( read_count ));
+}
+
+inline long Sample_Ring::write_space( unsigned long* pos ) const
+{
+	*pos = write_count & mask;
+	return space_avail();
+}
+
+inline void Sample_Ring::commit_write( long count )
+{
+	STORE_RELEASE( write_count, write_count + count );
+}
+
+long Sample_Ring::write( blip_sample_t const* in, long count )
+{
+	unsigned long pos;
+	long space = write_space( &pos );
+	if ( count > space )
+	{
+		STORE_RELEASE( overruns, overruns + (count - space) );
+		count = space;
+	}
+	
+	long first = min( count, capacity() - (long) pos );
+	memcpy( buf + pos, in, first * sizeof *buf );
+	memcpy( buf, in + first, (count - first) * sizeof *buf );
+	
+	commit_write( count );
+	return count;
+}
+
+long Sample_Ring::write( Multi_Buffer& in )
+{
+	unsigned long pos;
+	long space = write_space( &pos );
+	long avail = in.samples_avail();
+	if ( avail > space )
+		STORE_RELEASE( overruns, overruns + (avail - space) );
+	
+	// read into end of ring, then wrap around to beginning
+	long count = in.read_samples( buf + pos, min( space, capacity() - (long) pos ) );
+	if ( count < space )
+		count += in.read_samples( buf, space - count );
+	
+	commit_write( count );
+	
+	// drop samples that didn't fit so buffer doesn't back up
+	if ( in.samples_avail() )
+	{
+		blip_sample_t discard [256];
+		while ( in.read_samples( discard, sizeof discard / sizeof *discard ) ) { }
+	}
+	
+	return count;
+}
+
+double Sample_Ring::rate_factor( double target_fill, double max_deviation ) const
+{
+	double fill = (double) (capacity() - space_avail()) / capacity();
+	double error = (fill - target_fill) / (fill < target_fill ? target_fill : 1.0 - target_fill);
+	return 1.0 + max_deviation * error;
+}
+
+// Consumer
+
+long Sample_Ring::samples_avail() const
+{
+	return (long) (LOAD_ACQUIRE( write_count ) - read_count);
+}
+
+long Sample_Ring::read( blip_sample_t* out, long count )
+{
+	long avail = samples_avail();
+	long n = count;
+	if ( n > avail )
+	{
+		n = avail;
+		STORE_RELEASE( underruns, underruns + 1 );
+		memset( out + n, 0, (count - n) * sizeof *out );
+	}
+	
+	unsigned long pos = read_count & mask;
+	long first = min( n, capacity() - (long) pos );
+	memcpy( out, buf + pos, first * sizeof *out );
+	memcpy( out + first, buf, (n - first) * sizeof *out );
+	
+	STORE_RELEASE( read_count, read_count + n );
+	return n;
+}
+
+// Statistics
+
+unsigned long Sample_Ring::underrun_count() const
+{
+	return LOAD_ACQUIRE( underruns );
+}
+
+unsigned long Sample_Ring::overrun_count() const
+{
+	return LOAD_ACQUIRE( overruns );
+}
+
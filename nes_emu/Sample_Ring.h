@@ -0,0 +1,86 @@
+
+// Lock-free sample queue between emulation thread and audio output thread
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include "Multi_Buffer.h"
+
+// Single-producer, single-consumer ring of samples. The emulation thread writes
+// each frame's samples and an audio callback thread reads them at its own pace.
+// Neither side blocks; the only shared state is one read and one write count.
+// Stereo samples are kept as interleaved pairs, so both sides must use even counts.
+class Sample_Ring {
+public:
+	Sample_Ring();
+	~Sample_Ring();
+	
+	// Set capacity to at least count samples and clear ring. Latency is bounded by
+	// capacity. Not thread-safe; call before either side starts using the ring.
+	blargg_err_t resize( long count );
+	
+	// Remove all samples and reset statistics. Not thread-safe.
+	void clear();
+	
+	// Total number of samples ring can hold
+	long capacity() const { return mask + 1; }
+	
+// Producer (emulation thread)
+	
+	// Add count samples to ring. Returns number added, which is less than count
+	// only if ring filled up (the excess is dropped and counted as an overrun).
+	long write( blip_sample_t const* in, long count );
+	
+	// Read all samples available in buffer directly into ring, without an
+	// intermediate copy. Returns number of samples added.
+	long write( Multi_Buffer& );
+	
+	// Number of samples that can be written without overrun
+	long space_avail() const;
+	
+	// Factor to scale emulated frame rate by (see Nes_Emu::set_frame_rate()) so that
+	// the consumer's actual playback rate keeps ring near target_fill (0.0 to 1.0)
+	// of capacity. Adjustment is at most max_deviation (e.g. 0.005 = 0.5%),
+	// which is inaudible as a pitch change. When the ring runs low this lowers the
+	// frame rate, generating more samples per frame.
+	double rate_factor( double target_fill = 0.5, double max_deviation = 0.005 ) const;
+	
+// Consumer (audio thread)
+	
+	// Read count samples into out. If fewer are available, the rest of out is
+	// filled with silence and an underrun is counted. Returns number of samples
+	// actually read.
+	long read( blip_sample_t* out, long count );
+	
+	// Number of samples that can be read
+	long samples_avail() const;
+	
+// Statistics (can be read from either thread)
+	
+	// Number of read() calls that didn't have enough samples
+	unsigned long underrun_count() const;
+	
+	// Number of samples dropped by write() because ring was full
+	unsigned long overrun_count() const;
+	
+private:
+	// noncopyable
+	Sample_Ring( const Sample_Ring& );
+	Sample_Ring& operator = ( const Sample_Ring& );
+	
+	blip_sample_t* buf;
+	long mask;
+	
+	// Samples written and read so far; each is only modified by one side
+	unsigned long write_count;
+	unsigned long read_count;
+	
+	// Each is only modified by one side
+	unsigned long underruns;
+	unsigned long overruns;
+	
+	long write_space( unsigned long* pos ) const;
+	void commit_write( long count );
+};
+
+#endif
@@ -0,0 +1,162 @@
+
+// Nes_Emu 0.7.0
+
+#include "Stem_Buffer.h"
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+Stem_Buffer::Stem_Buffer() : Multi_Buffer( 1 )
+{
+	chan_count = 1;
+	buf_count = 0;
+	bass_freq_ = 16;
+}
+
+Stem_Buffer::~Stem_Buffer()
+{
+}
+
+blargg_err_t Stem_Buffer::set_channel_count( int n )
+{
+	require( 0 < n && n <= max_chans );
+	
+	// allocate any new buffers to match existing ones
+	if ( sample_rate() )
+	{
+		for ( ; buf_count < n; buf_count++ )
+		{
+			Blip_Buffer& b = bufs [buf_count];
+			RETURN_ERR( b.set_sample_rate( sample_rate(), length() ) );
+			b.clock_rate( bufs [0].clock_rate() );
+			b.bass_freq( bass_freq_ );
+		}
+	}
+	
+	// unused buffers don't get frames, so start all channels over together
+	chan_count = n;
+	clear();
+	set_samples_per_frame( n );
+	channels_changed();
+	return 0;
+}
+
+blargg_err_t Stem_Buffer::set_sample_rate( long rate, int msec )
+{
+	buf_count = 0;
+	for ( ; buf_count < chan_count; buf_count++ )
+	{
+		RETURN_ERR( bufs [buf_count].set_sample_rate( rate, msec ) );
+		bufs [buf_count].bass_freq( bass_freq_ );
+	}
+	return Multi_Buffer::set_sample_rate( bufs [0].sample_rate(), bufs [0].length() );
+}
+
+void Stem_Buffer::clock_rate( long rate )
+{
+	for ( int i = 0; i < buf_count; i++ )
+		bufs [i].clock_rate( rate );
+}
+
+void Stem_Buffer::bass_freq( int bass )
+{
+	bass_freq_ = bass;
+	for ( int i = 0; i < buf_count; i++ )
+		bufs [i].bass_freq( bass );
+}
+
+void Stem_Buffer::clear()
+{
+	for ( int i = 0; i < buf_count; i++ )
+		bufs [i].clear();
+}
+
+Stem_Buffer::channel_t Stem_Buffer::channel( int index )
+{
+	require( (unsigned) index < (unsigned) chan_count );
+	channel_t ch;
+	ch.center = &bufs [index];
+	ch.left   = &bufs [index];
+	ch.right  = &bufs [index];
+	return ch;
+}
+
+void Stem_Buffer::end_frame( blip_time_t time, bool )
+{
+	for ( int i = 0; i < chan_count; i++ )
+		bufs [i].end_frame( time );
+}
+
+void Stem_Buffer::read_chan( Blip_Buffer& buf, blip_sample_t* out, int step, long count )
+{
+	Blip_Reader reader;
+	int const bass = reader.begin( buf );
+	blip_long block [blip_block_size];
+	for ( long remain = count; remain; )
+	{
+		int n = blip_block_size;
+		if ( n > remain )
+			n = (int) remain;
+		remain -= n;
+		
+		reader.read_block( block, n, bass );
+		if ( step == 1 )
+		{
+			blip_pack_mono( out, block, n );
+			out += n;
+		}
+		else
+		{
+			for ( int i = 0; i < n; i++ )
+			{
+				blip_long s = block [i];
+				if ( (blip_sample_t) s != s )
+					s = 0x7FFF - (s >> 24); // clamp
+				*out = (blip_sample_t) s;
+				out += step;
+			}
+		}
+	}
+	reader.end( buf );
+	buf.remove_samples( count );
+}
+
+long Stem_Buffer::read_stems( blip_sample_t* const* outs, long count )
+{
+	long avail = bufs [0].samples_avail();
+	if ( count > avail )
+		count = avail;
+	if ( count )
+	{
+		for ( int i = 0; i < chan_count; i++ )
+			read_chan( bufs [i], outs [i], 1, count );
+	}
+	return count;
+}
+
+long Stem_Buffer::read_samples( blip_sample_t* out, long count )
+{
+	require( count % chan_count == 0 );
+	count /= chan_count;
+	
+	long avail = bufs [0].samples_avail();
+	if ( count > avail )
+		count = avail;
+	if ( count )
+	{
+		// each channel is integrated in blocks, then stored at its position in frames
+		for ( int i = 0; i < chan_count; i++ )
+			read_chan( bufs [i], out + i, chan_count, count );
+	}
+	return count * chan_count;
+}
@@ -0,0 +1,57 @@
+
+// Multi-channel sound buffer that keeps every channel separate, for stem export
+
+// Nes_Emu 0.7.0
+
+#ifndef STEM_BUFFER_H
+#define STEM_BUFFER_H
+
+#include "Multi_Buffer.h"
+
+// Stem_Buffer gives each channel its own Blip_Buffer and outputs one sample per
+// channel in each frame, without mixing. With Nes_Emu, channels are in the
+// order 0) Square 1, 1) Square 2, 2) Triangle, 3) Noise, 4) DMC, followed
+// by any expansion sound channels of the current cartridge. Every channel
+// shares the same time base, so a single emulation pass yields all stems in sync.
+class Stem_Buffer : public Multi_Buffer {
+public:
+	Stem_Buffer();
+	~Stem_Buffer();
+	
+	// Maximum number of channels
+	enum { max_chans = 16 };
+	
+	// Number of channels, which is also the number of samples in each output frame
+	int channel_count() const { return chan_count; }
+	
+	// Read at most count samples of each channel into separate arrays, where
+	// outs [i] receives channel i. Returns number of samples read per channel.
+	long read_stems( blip_sample_t* const* outs, long count );
+	
+	// See Multi_Buffer. Output of read_samples() is interleaved, one sample
+	// per channel, and count must be a multiple of channel_count().
+	blargg_err_t set_channel_count( int );
+	blargg_err_t set_sample_rate( long, int msec = blip_default_length );
+	void clock_rate( long );
+	void bass_freq( int );
+	void clear();
+	channel_t channel( int index );
+	void end_frame( blip_time_t, bool unused = true );
+	long samples_avail() const;
+	long read_samples( blip_sample_t*, long );
+	
+private:
+	Blip_Buffer bufs [max_chans];
+	int chan_count; // channels in use
+	int buf_count;  // buffers allocated, at least chan_count once sample rate is set
+	int bass_freq_;
+	
+	void read_chan( Blip_Buffer&, blip_sample_t* out, int step, long count );
+};
+
+inline long Stem_Buffer::samples_avail() const
+{
+	return bufs [0].samples_avail() * chan_count;
+}
+
+#endif
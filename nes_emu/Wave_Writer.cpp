@@ -0,0 +1,110 @@
+
+// Nes_Emu 0.7.0
+
+#include "Wave_Writer.h"
+
+#include "blargg_endian.h"
+
+/* Copyright (C) 2026 the QuickNES contributors. This module is free software;
+you can redistribute it and/or modify it under the terms of the GNU Lesser
+General Public License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version. This
+module is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for
+more details. You should have received a copy of the GNU Lesser General
+Public License along with this module; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA */
+
+#include "blargg_source.h"
+
+int const header_size = 0x2C;
+
+Wave_Writer::Wave_Writer()
+{
+	sample_count_ = 0;
+	sample_rate = 0;
+	chan_count = 1;
+}
+
+Wave_Writer::~Wave_Writer()
+{
+	close();
+}
+
+blargg_err_t Wave_Writer::write_header()
+{
+	long data_size = sample_count_ * sizeof (blip_sample_t);
+	int frame_size = chan_count * sizeof (blip_sample_t);
+	
+	unsigned char h [header_size] = {
+		'R','I','F','F',
+		0,0,0,0,        // length of rest of file
+		'W','A','V','E',
+		'f','m','t',' ',
+		0x10,0,0,0,     // size of fmt chunk
+		1,0,            // uncompressed format
+		0,0,            // channel count
+		0,0,0,0,        // sample rate
+		0,0,0,0,        // bytes per second
+		0,0,            // bytes per sample frame
+		16,0,           // bits per sample
+		'd','a','t','a',
+		0,0,0,0         // size of sample data
+	};
+	set_le32( h + 0x04, header_size - 8 + data_size );
+	set_le16( h + 0x16, chan_count );
+	set_le32( h + 0x18, sample_rate );
+	set_le32( h + 0x1C, sample_rate * frame_size );
+	set_le16( h + 0x20, frame_size );
+	set_le32( h + 0x28, data_size );
+	return file.write( h, sizeof h );
+}
+
+blargg_err_t Wave_Writer::open( const char* path, long rate, int chans )
+{
+	require( chans > 0 );
+	RETURN_ERR( close() );
+	sample_count_ = 0;
+	sample_rate = rate;
+	chan_count = chans;
+	RETURN_ERR( file.open( path ) );
+	return write_header(); // rewritten with sizes by close()
+}
+
+blargg_err_t Wave_Writer::write( blip_sample_t const* in, long count )
+{
+	require( count % chan_count == 0 );
+	sample_count_ += count;
+	
+	#if BLARGG_BIG_ENDIAN
+		unsigned char buf [1024];
+		while ( count )
+		{
+			int n = sizeof buf / 2;
+			if ( n > count )
+				n = (int) count;
+			count -= n;
+			for ( int i = 0; i < n; i++ )
+				set_le16( buf + i * 2, *in++ );
+			RETURN_ERR( file.write( buf, n * 2 ) );
+		}
+		return 0;
+	#else
+		return file.write( in, count * sizeof *in );
+	#endif
+}
+
+blargg_err_t Wave_Writer::close()
+{
+	blargg_err_t err = 0;
+	if ( file.file() )
+	{
+		if ( fseek( file.file(), 0, SEEK_SET ) )
+			err = "Couldn't seek in file";
+		if ( !err )
+			err = write_header();
+		file.close();
+	}
+	return err;
+}
@@ -0,0 +1,44 @@
+
+// Multi-channel 16-bit WAVE sound file writer
+
+// Nes_Emu 0.7.0
+
+#ifndef WAVE_WRITER_H
+#define WAVE_WRITER_H
+
+#include "abstract_file.h"
+#include "Blip_Buffer.h"
+
+class Wave_Writer {
+public:
+	Wave_Writer();
+	~Wave_Writer();
+	
+	// Create file for sound with chan_count interleaved channels. The header
+	// is completed by close().
+	blargg_err_t open( const char* path, long sample_rate, int chan_count = 1 );
+	
+	// Append count samples, interleaved if there is more than one channel
+	blargg_err_t write( blip_sample_t const*, long count );
+	
+	// Number of samples written so far
+	long sample_count() const { return sample_count_; }
+	
+	// Write final header and close file. Done by destructor if not called
+	// explicitly, but then any error is lost.
+	blargg_err_t close();
+	
+private:
+	// noncopyable
+	Wave_Writer( const Wave_Writer& );
+	Wave_Writer& operator = ( const Wave_Writer& );
+	
+	Std_File_Writer file;
+	long sample_count_;
+	long sample_rate;
+	int chan_count;
+	
+	blargg_err_t write_header();
+};
+
+#endif
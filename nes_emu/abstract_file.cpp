@@ -63,6 +63,13 @@ error_t Std_File_Writer::write( const void* p, long s )
 	return 0;
 }
 
+error_t Std_File_Writer::flush()
+{
+	if ( fflush( file_ ) )
+		RAISE_ERROR( "Couldn't write to file" );
+	return 0;
+}
+
 void Std_File_Writer::close()
 {
 	if ( file_ ) {
@@ -295,6 +302,13 @@ Gzip_File_Writer::error_t Gzip_File_Writer::write( const void* p, long s )
 	return 0;
 }
 
+Gzip_File_Writer::error_t Gzip_File_Writer::flush()
+{
+	if ( gzflush( (gzFile) file_, Z_SYNC_FLUSH ) != Z_OK )
+		return "Couldn't write to file";
+	return 0;
+}
+
 void Gzip_File_Writer::close()
 {
 	if ( file_ )
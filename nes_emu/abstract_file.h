@@ -21,6 +21,10 @@ public:
 	// Write 'n' bytes. NULL on success, otherwise error string.
 	virtual error_t write( const void*, long n ) = 0;
 	
+	// Pass any buffered data on to underlying file. NULL on success, otherwise
+	// error string. Default does nothing.
+	virtual error_t flush() { return 0; }
+	
 	void satisfy_lame_linker_();
 private:
 	// noncopyable
@@ -42,6 +46,8 @@ public:
 	
 	error_t write( const void*, long );
 	
+	error_t flush();
+	
 	void close();
 	
 protected:
@@ -154,6 +160,7 @@ public:
 	
 	error_t open( const char*, int compression = -1 );
 	error_t write( const void*, long );
+	error_t flush();
 	void close();
 };
 #endif
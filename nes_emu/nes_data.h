@@ -102,6 +102,7 @@ unsigned const max_mapper_state_size = 256;
 struct mapper_state_t
 {
 	int size;
+	int sound_offset; // expansion sound state starts here; negative if unknown
 	union {
 		double align;
 		byte data [max_mapper_state_size];